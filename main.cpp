@@ -4,10 +4,41 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
 #include <vector>
 #include <string>
 #include <cmath>
+#include <cfloat>
+#include <cstdarg>
+#include <cctype>
 #include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <queue>
+#include <atomic>
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+#include <memory>
+#include <new>
+#include <chrono>
+#include <sys/stat.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FLOORPLAN_SSE2 1
+#endif
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -62,6 +93,127 @@ void main() {
 }
 )";
 
+// Instanced shapes: aPos is a unit mesh (quad in [0,1]^2, circle in [-1,1]^2) that each
+// instance places with aRect (x,y,w,h; circles use cx,cy,r,r). aLayer picks the texture
+// array layer (-1 = flat color) and is sampled by ARRAY_FRAG_SRC.
+const char* INST_VERT_SRC = R"(
+#version 330 core
+layout(location = 0) in vec2 aPos;
+layout(location = 3) in vec4 aRect;
+layout(location = 4) in vec4 aColor;
+layout(location = 5) in int aLayer;
+
+out vec4 vColor;
+out vec2 vUV;
+flat out int vLayer;
+
+uniform mat4 uMVP;
+uniform bool uCentered;
+
+void main() {
+    vColor = aColor;
+    vUV = uCentered ? aPos*0.5 + 0.5 : aPos;
+    vLayer = aLayer;
+    gl_Position = uMVP * vec4(aRect.xy + aPos*aRect.zw, 0.0, 1.0);
+}
+)";
+
+const char* ARRAY_FRAG_SRC = R"(
+#version 330 core
+in vec4 vColor;
+in vec2 vUV;
+flat in int vLayer;
+out vec4 FragColor;
+
+uniform sampler2DArray uTextures;
+
+void main() {
+    if (vLayer >= 0)
+        FragColor = texture(uTextures, vec3(vUV, float(vLayer))) * vColor;
+    else
+        FragColor = vColor;
+}
+)";
+
+// Analytic shapes: one unit quad per instance, covered by a signed distance field in
+// the fragment shader, so edges are antialiased at any zoom and need no tessellation.
+// aRect is (x,y,w,h) or, with uCentered, (cx,cy,rx,ry). The quad grows by a pixel of
+// padding plus half the line width so edges keep their falloff. uPixel is world units
+// per pixel; uLineWidth is in pixels; uRadius rounds rect corners (world units).
+const char* SDF_VERT_SRC = R"(
+#version 330 core
+layout(location = 0) in vec2 aPos;
+layout(location = 3) in vec4 aRect;
+layout(location = 4) in vec4 aColor;
+layout(location = 5) in int aLayer;
+
+out vec4 vColor;
+out vec2 vLocal;
+flat out vec2 vHalf;
+flat out int vLayer;
+
+uniform mat4 uMVP;
+uniform bool uCentered;
+uniform float uPixel;
+uniform float uLineWidth;
+
+void main() {
+    vec2 center = uCentered ? aRect.xy : aRect.xy + aRect.zw*0.5;
+    vec2 halfSize = uCentered ? aRect.zw : aRect.zw*0.5;
+    vLocal = (aPos*2.0 - 1.0) * (halfSize + vec2((uLineWidth*0.5 + 1.0) * uPixel));
+    vHalf = halfSize;
+    vColor = aColor;
+    vLayer = aLayer;
+    gl_Position = uMVP * vec4(center + vLocal, 0.0, 1.0);
+}
+)";
+
+const char* SDF_FRAG_SRC = R"(
+#version 330 core
+in vec4 vColor;
+in vec2 vLocal;
+flat in vec2 vHalf;
+flat in int vLayer;
+out vec4 FragColor;
+
+uniform sampler2DArray uTextures;
+uniform int uShape; // 0 circle, 1 rect outline, 2 door swing (quarter wedge), 3 grid
+uniform float uPixel;
+uniform float uLineWidth;
+uniform float uRadius;
+uniform float uGridStep;
+
+float coverage(float d){ return clamp(0.5 - d/uPixel, 0.0, 1.0); }
+float box(vec2 p, vec2 b, float r){
+    vec2 q = abs(p) - b + r;
+    return length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - r;
+}
+
+void main() {
+    vec2 p = vLocal;
+    float halfWidth = uLineWidth*0.5*uPixel;
+    float a;
+    if (uShape == 0) {
+        a = coverage(length(p) - vHalf.x);
+    } else if (uShape == 1) {
+        a = coverage(abs(box(p, vHalf, uRadius)) - halfWidth);
+    } else if (uShape == 2) {
+        float r = vHalf.x;
+        float arc = (p.x >= 0.0 && p.y >= 0.0) ? abs(length(p) - r)
+                                               : min(length(p - vec2(r, 0.0)), length(p - vec2(0.0, r)));
+        float edges = min(length(p - vec2(clamp(p.x, 0.0, r), 0.0)), length(p - vec2(0.0, clamp(p.y, 0.0, r))));
+        float wedge = (p.x >= 0.0 && p.y >= 0.0) ? coverage(length(p) - r) : 0.0;
+        a = max(coverage(min(arc, edges) - halfWidth), 0.25*wedge);
+    } else {
+        vec2 g = abs(mod(p + vHalf + 0.5*uGridStep, uGridStep) - 0.5*uGridStep);
+        a = coverage(min(g.x, g.y) - halfWidth) * coverage(box(p, vHalf, 0.0) - halfWidth);
+    }
+    vec4 c = vLayer >= 0 ? texture(uTextures, vec3(vLocal/vHalf*0.5 + 0.5, float(vLayer))) * vColor : vColor;
+    if (a <= 0.0) discard;
+    FragColor = vec4(c.rgb, c.a*a);
+}
+)";
+
 // ---------------------- Shader utilities ----------------------
 static GLuint compileShader(GLenum t, const char* src){
     GLuint s = glCreateShader(t);
@@ -83,704 +235,5657 @@ static GLuint createProgram(const char* vs,const char* fs){
     return p;
 }
 
+// ---------------------- Frame recorder ----------------------
+// While `recording`, the GL wrappers below (ShaderProgram, gGLState, DrawBuffer and
+// InstanceBuffer) append what they send to GL: program switches, uniform uploads, texture
+// binds, and draws with the vertex or instance data they read. A buffer's data is stored
+// once per upload, so a static buffer drawn in several ranges costs one copy. Textures
+// are recorded by role, not by id or content; FrameCapture (further down) fills in the
+// roles, adds the ImGui lists and plan state, and writes the file.
+enum TextureRole : uint8_t { TR_NONE, TR_SCENE_LAYERS, TR_FRONT_ELEVATION, TR_SIDE_ELEVATION, TR_FONT, TR_ROLE_COUNT };
+struct FrameRecorder {
+    enum Op : uint8_t { OP_PROGRAM, OP_MAT4, OP_FLOAT, OP_INT, OP_TEXTURE, OP_DRAW_ARRAYS, OP_DRAW_INSTANCED };
+    enum BlobKind : uint8_t { BLOB_VERTICES, BLOB_INSTANCES };
+    struct Blob { uint64_t at, bytes; uint8_t kind; };
+    bool recording = false;
+    std::vector<unsigned char> ops, data;
+    std::vector<Blob> blobs;
+    std::vector<std::string> names; // programs and uniforms, referenced by index
+    std::unordered_map<std::string, uint16_t> nameIds;
+    std::unordered_map<const void*, uint32_t> live; // buffer object -> blob of its current contents
+    std::unordered_map<GLuint, uint8_t> textureRoles;
+    uint32_t opCount = 0, drawCount = 0;
+
+    void start(){
+        ops.clear(); data.clear(); blobs.clear(); names.clear(); nameIds.clear(); live.clear();
+        opCount = drawCount = 0;
+        recording = true;
+    }
+    void stop(){ recording = false; live.clear(); }
+    template<class T> void put(const T &v){ const unsigned char *p = (const unsigned char*)&v; ops.insert(ops.end(), p, p+sizeof(T)); }
+    void op(Op o){ put((uint8_t)o); opCount++; }
+    uint16_t name(const std::string &n){
+        auto it = nameIds.find(n);
+        if(it != nameIds.end()) return it->second;
+        uint16_t id = (uint16_t)names.size();
+        names.push_back(n); nameIds[n] = id;
+        return id;
+    }
+    uint8_t role(GLuint tex) const { auto it = textureRoles.find(tex); return it==textureRoles.end() ? (uint8_t)TR_NONE : it->second; }
+
+    void program(const char *programName){ op(OP_PROGRAM); put(name(programName)); }
+    void uniform(Op o, const std::string &uniformName, const void *v, size_t bytes){
+        op(o); put(name(uniformName));
+        ops.insert(ops.end(), (const unsigned char*)v, (const unsigned char*)v + bytes);
+    }
+    void texture(GLenum target, int unit, GLuint tex){
+        op(OP_TEXTURE); put((uint8_t)(target==GL_TEXTURE_2D_ARRAY)); put((uint8_t)unit); put(role(tex));
+    }
+    // Called when a buffer's contents change, so the next draw stores them again.
+    void forget(const void *owner){ if(recording) live.erase(owner); }
+    uint32_t blob(const void *owner, BlobKind kind, const void *src, size_t bytes){
+        auto it = live.find(owner);
+        if(it != live.end()) return it->second;
+        data.resize((data.size()+15) & ~(size_t)15);
+        blobs.push_back({data.size(), bytes, kind});
+        data.insert(data.end(), (const unsigned char*)src, (const unsigned char*)src + bytes);
+        return live[owner] = (uint32_t)blobs.size()-1;
+    }
+    void drawArrays(const void *owner, const void *src, size_t bytes, GLenum mode, size_t first, size_t count){
+        uint32_t b = blob(owner, BLOB_VERTICES, src, bytes);
+        op(OP_DRAW_ARRAYS); put(b); put((uint32_t)mode); put((uint32_t)first); put((uint32_t)count);
+        drawCount++;
+    }
+    void drawInstanced(const void *owner, const void *src, size_t bytes, GLint first, GLint count, size_t instances){
+        uint32_t b = blob(owner, BLOB_INSTANCES, src, bytes);
+        op(OP_DRAW_INSTANCED); put(b); put((int32_t)first); put((int32_t)count); put((uint32_t)instances);
+        drawCount++;
+    }
+};
+static FrameRecorder gRecorder;
+
+// ---------------------- GL state cache ----------------------
+// Mirrors the bindings this file changes so redundant glUseProgram/glBindTexture calls
+// are skipped. All of our binds go through gGLState; anything that changes GL state
+// behind its back must call invalidate(). (The ImGui OpenGL3 backend restores the
+// program and texture bindings it touches, so it needs no invalidation.)
+struct GLStateCache {
+    static const int UNITS = 4;
+    static const GLuint UNKNOWN = 0xFFFFFFFFu;
+    GLuint program = UNKNOWN;
+    GLenum activeUnit = 0;
+    GLuint tex2D[UNITS], tex2DArray[UNITS];
+    GLStateCache(){ invalidate(); }
+
+    void invalidate(){
+        program = UNKNOWN; activeUnit = 0;
+        for(int i=0;i<UNITS;i++){ tex2D[i]=UNKNOWN; tex2DArray[i]=UNKNOWN; }
+    }
+    void useProgram(GLuint p){
+        if(p==program) return;
+        glUseProgram(p); program = p;
+    }
+    void bindTexture(GLenum target, GLuint tex, int unit=0){
+        GLuint &slot = target==GL_TEXTURE_2D_ARRAY ? tex2DArray[unit] : tex2D[unit];
+        if(slot==tex) return;
+        if(activeUnit != GL_TEXTURE0+(GLenum)unit){ activeUnit = GL_TEXTURE0+unit; glActiveTexture(activeUnit); }
+        glBindTexture(target, tex); slot = tex;
+        if(gRecorder.recording) gRecorder.texture(target, unit, tex);
+    }
+};
+static GLStateCache gGLState;
+
+// ---------------------- Shader program wrapper ----------------------
+// A linked program plus every active uniform's location, resolved once at link time.
+// Callers look a uniform up by name once, keep the returned slot, and set values by slot;
+// uploads whose value matches the last one sent to this program are skipped.
+struct ShaderProgram {
+    struct Slot {
+        std::string name;
+        GLint loc = -1;
+        bool known = false; // value below mirrors what the program holds
+        float f[16] = {};
+        GLint i = 0;
+    };
+    GLuint id = 0;
+    const char *name = ""; // how frame captures refer to it
+    std::vector<Slot> slots;
+
+    bool create(const char* vs, const char* fs, const char *programName){
+        name = programName;
+        id = createProgram(vs, fs);
+        GLint ok=0; glGetProgramiv(id, GL_LINK_STATUS, &ok);
+        if(!ok) return false;
+        GLint count=0; glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+        for(GLint u=0; u<count; u++){
+            char name[128]; GLsizei len=0; GLint size=0; GLenum type=0;
+            glGetActiveUniform(id, (GLuint)u, sizeof(name), &len, &size, &type, name);
+            Slot slot; slot.name.assign(name, len);
+            slot.loc = glGetUniformLocation(id, name);
+            slots.push_back(slot);
+        }
+        return true;
+    }
+    // Slot index for a uniform, or -1 if the program does not use it. Not for per-frame use.
+    int uniform(const char* name) const {
+        for(size_t k=0;k<slots.size();k++) if(slots[k].name==name) return (int)k;
+        return -1;
+    }
+    void use(){
+        if(gRecorder.recording && gGLState.program != id) gRecorder.program(name);
+        gGLState.useProgram(id);
+    }
+    // Drops the cached values so every uniform is sent (and recorded) again.
+    void forget(){ for(auto &s: slots) s.known = false; }
+
+    // The setters expect this program to be current.
+    void setMat4(int slot, const glm::mat4 &m){
+        if(slot<0) return;
+        Slot &s = slots[slot];
+        const float* v = glm::value_ptr(m);
+        if(s.known && memcmp(s.f, v, sizeof(s.f))==0) return;
+        memcpy(s.f, v, sizeof(s.f)); s.known = true;
+        glUniformMatrix4fv(s.loc, 1, GL_FALSE, v);
+        if(gRecorder.recording) gRecorder.uniform(FrameRecorder::OP_MAT4, s.name, v, sizeof(s.f));
+    }
+    void setFloat(int slot, float value){
+        if(slot<0) return;
+        Slot &s = slots[slot];
+        if(s.known && s.f[0]==value) return;
+        s.f[0] = value; s.known = true;
+        glUniform1f(s.loc, value);
+        if(gRecorder.recording) gRecorder.uniform(FrameRecorder::OP_FLOAT, s.name, &value, sizeof(value));
+    }
+    void setInt(int slot, GLint value){ // ints, bools and samplers
+        if(slot<0) return;
+        Slot &s = slots[slot];
+        if(s.known && s.i==value) return;
+        s.i = value; s.known = true;
+        glUniform1i(s.loc, value);
+        if(gRecorder.recording) gRecorder.uniform(FrameRecorder::OP_INT, s.name, &value, sizeof(value));
+    }
+    void destroy(){
+        if(id){ if(gGLState.program==id) gGLState.invalidate(); glDeleteProgram(id); }
+        id = 0; slots.clear();
+    }
+};
+
+// The scene's programs with their uniform slots resolved up front.
+struct SceneShaders {
+    ShaderProgram flat; // VERT_SRC + FRAG_SRC: DrawBuffer triangles and lines
+    ShaderProgram inst; // INST_VERT_SRC + ARRAY_FRAG_SRC: instanced rects and circles
+    ShaderProgram sdf;  // SDF_VERT_SRC + SDF_FRAG_SRC: analytic circles, outlines, swings, grid
+    int flatMVP=-1, flatUseTexture=-1, flatTexture=-1;
+    int instMVP=-1, instTextures=-1, instCentered=-1;
+    int sdfMVP=-1, sdfTextures=-1, sdfCentered=-1, sdfShape=-1, sdfPixel=-1, sdfLineWidth=-1, sdfRadius=-1, sdfGridStep=-1;
+
+    void init(){
+        flat.create(VERT_SRC, FRAG_SRC, "flat");
+        inst.create(INST_VERT_SRC, ARRAY_FRAG_SRC, "inst");
+        sdf.create(SDF_VERT_SRC, SDF_FRAG_SRC, "sdf");
+        flatMVP = flat.uniform("uMVP");
+        flatUseTexture = flat.uniform("useTexture");
+        flatTexture = flat.uniform("uTexture");
+        instMVP = inst.uniform("uMVP");
+        instTextures = inst.uniform("uTextures");
+        instCentered = inst.uniform("uCentered");
+        sdfMVP = sdf.uniform("uMVP");
+        sdfTextures = sdf.uniform("uTextures");
+        sdfCentered = sdf.uniform("uCentered");
+        sdfShape = sdf.uniform("uShape");
+        sdfPixel = sdf.uniform("uPixel");
+        sdfLineWidth = sdf.uniform("uLineWidth");
+        sdfRadius = sdf.uniform("uRadius");
+        sdfGridStep = sdf.uniform("uGridStep");
+    }
+    ShaderProgram *byName(const std::string &n){
+        for(ShaderProgram *p: {&flat, &inst, &sdf}) if(n==p->name) return p;
+        return nullptr;
+    }
+    void forgetUniforms(){ flat.forget(); inst.forget(); sdf.forget(); }
+    void destroy(){ flat.destroy(); inst.destroy(); sdf.destroy(); }
+};
+
+// ---------------------- Allocation counters ----------------------
+// Every global new is counted for the profiler panel and --bench. Relaxed atomics: the
+// totals are statistics and order nothing.
+static std::atomic<uint64_t> gAllocCount{0}, gAllocBytes{0};
+// As the standard requires, a failed malloc calls the installed new-handler and retries;
+// bad_alloc only once there is none.
+void* operator new(size_t n){
+    gAllocCount.fetch_add(1, std::memory_order_relaxed);
+    gAllocBytes.fetch_add(n, std::memory_order_relaxed);
+    for(;;){
+        if(void* p = malloc(n ? n : 1)) return p;
+        std::new_handler handler = std::get_new_handler();
+        if(!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+// Counted by the throwing form it forwards to.
+void* operator new(size_t n, const std::nothrow_t&) noexcept {
+    try { return ::operator new(n); }
+    catch(...) { return nullptr; }
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { free(p); }
+
+// ---------------------- Profiler ----------------------
+// Named passes timed on the CPU (nestable scopes) and optionally on the GPU with
+// GL_TIME_ELAPSED queries. Queries rotate through GPU_LATENCY sets and are read back
+// GPU_LATENCY frames later, and only once available, so timing never stalls the
+// pipeline. Time-elapsed queries cannot nest; an inner GPU scope records CPU time only.
+// Draw buffers add their draw calls, vertices and upload bytes to `frame`.
+struct Profiler {
+    static const int MAX_PASSES = 24;
+    static const int HISTORY = 240;
+    static const int GPU_LATENCY = 3;
+    typedef std::chrono::steady_clock Clock;
+
+    struct Pass {
+        const char *name = nullptr;
+        int depth = 0;
+        double cpuMs = 0.0, gpuMs = 0.0;  // last completed frame
+        double cpuAccum = 0.0;            // this frame (a pass may run several times)
+        GLuint queries[GPU_LATENCY] = {};
+        bool issued[GPU_LATENCY] = {};
+        double issuedAtUs[GPU_LATENCY] = {}; // CPU start, to place GPU spans in the trace
+        float history[HISTORY] = {};
+    };
+    struct Counters { uint64_t drawCalls = 0, vertices = 0, instances = 0, bytesUploaded = 0, allocations = 0, allocBytes = 0; };
+    struct TraceEvent { const char *name; double startUs, durUs; int tid; };
+
+    bool enabled = true;
+    bool showPanel = false;
+    Pass passes[MAX_PASSES];
+    int passCount = 0;
+    int depth = 0;
+    int gpuActive = -1; // pass owning the running time-elapsed query
+    int slot = 0;       // query set of the current frame
+    float frameMs[HISTORY] = {};
+    int historyPos = 0;
+    Clock::time_point epoch = Clock::now(), frameStart;
+    Counters frame, last;
+    uint64_t allocCountAtStart = 0, allocBytesAtStart = 0;
+    // Chrome trace capture (chrome://tracing, Perfetto)
+    int traceFramesLeft = 0;
+    std::vector<TraceEvent> trace;
+    std::string tracePath = "frame_trace.json";
+
+    double nowUs() const { return std::chrono::duration<double, std::micro>(Clock::now() - epoch).count(); }
+    int passId(const char *name){
+        for(int i=0;i<passCount;i++) if(passes[i].name==name || !strcmp(passes[i].name, name)) return i;
+        if(passCount == MAX_PASSES) return -1;
+        passes[passCount].name = name;
+        passes[passCount].depth = depth;
+        return passCount++;
+    }
+
+    void beginFrame(){
+        if(!enabled) return;
+        frameStart = Clock::now();
+        slot = (slot + 1) % GPU_LATENCY;
+        frame = Counters();
+        allocCountAtStart = gAllocCount.load(std::memory_order_relaxed);
+        allocBytesAtStart = gAllocBytes.load(std::memory_order_relaxed);
+        for(int i=0;i<passCount;i++){
+            Pass &p = passes[i];
+            p.cpuAccum = 0.0;
+            if(!p.issued[slot]) continue;
+            GLuint available = 0;
+            glGetQueryObjectuiv(p.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+            if(!available) continue; // keep the old value rather than wait
+            GLuint64 ns = 0;
+            glGetQueryObjectui64v(p.queries[slot], GL_QUERY_RESULT, &ns);
+            p.gpuMs = ns / 1.0e6;
+            p.issued[slot] = false;
+            if(traceFramesLeft > 0) trace.push_back({p.name, p.issuedAtUs[slot], ns / 1.0e3, 2});
+        }
+    }
+    void endFrame(){
+        if(!enabled) return;
+        float ms = (float)std::chrono::duration<double, std::milli>(Clock::now() - frameStart).count();
+        frameMs[historyPos] = ms;
+        for(int i=0;i<passCount;i++){ passes[i].cpuMs = passes[i].cpuAccum; passes[i].history[historyPos] = (float)passes[i].cpuAccum; }
+        historyPos = (historyPos + 1) % HISTORY;
+        frame.allocations = gAllocCount.load(std::memory_order_relaxed) - allocCountAtStart;
+        frame.allocBytes = gAllocBytes.load(std::memory_order_relaxed) - allocBytesAtStart;
+        last = frame;
+        if(traceFramesLeft > 0 && --traceFramesLeft == 0) writeTrace();
+    }
+
+    // RAII scope: ProfileScope s("render", true) times the enclosing block.
+    struct Scope {
+        Profiler &prof; int id; bool gpu; double startUs;
+        Scope(Profiler &p, const char *name, bool gpuTimed=false) : prof(p), id(-1), gpu(false), startUs(0.0) {
+            if(!prof.enabled) return;
+            id = prof.passId(name);
+            if(id < 0) return;
+            prof.depth++;
+            startUs = prof.nowUs();
+            if(gpuTimed && prof.gpuActive < 0){
+                Pass &ps = prof.passes[id];
+                if(!ps.queries[0]) glGenQueries(GPU_LATENCY, ps.queries);
+                glBeginQuery(GL_TIME_ELAPSED, ps.queries[prof.slot]);
+                ps.issuedAtUs[prof.slot] = startUs;
+                prof.gpuActive = id; gpu = true;
+            }
+        }
+        ~Scope(){
+            if(id < 0) return;
+            if(gpu){
+                glEndQuery(GL_TIME_ELAPSED);
+                prof.passes[id].issued[prof.slot] = true;
+                prof.gpuActive = -1;
+            }
+            double end = prof.nowUs();
+            prof.passes[id].cpuAccum += (end - startUs) / 1000.0;
+            prof.depth--;
+            if(prof.traceFramesLeft > 0) prof.trace.push_back({prof.passes[id].name, startUs, end - startUs, 1});
+        }
+    };
+
+    // Rolling frame graph, per-pass CPU/GPU ms and last frame's counters; `extra`
+    // appends caller-owned rows (per-buffer vertex counts) inside the same window.
+    void drawPanel(const std::function<void()> &extra){
+        if(!showPanel) return;
+        ImGui::SetNextWindowSize(ImVec2(420, 520), ImGuiCond_FirstUseEver);
+        if(!ImGui::Begin("Profiler", &showPanel)){ ImGui::End(); return; }
+        int lastPos = (historyPos + HISTORY - 1) % HISTORY;
+        float worst = 0.0f, sum = 0.0f;
+        for(float ms: frameMs){ worst = std::max(worst, ms); sum += ms; }
+        char overlayText[64];
+        snprintf(overlayText, sizeof(overlayText), "%.2f ms (avg %.2f, max %.2f)", frameMs[lastPos], sum/HISTORY, worst);
+        ImGui::PlotLines("Frame", frameMs, HISTORY, historyPos, overlayText, 0.0f, std::max(worst, 16.7f), ImVec2(0, 60));
+        if(ImGui::BeginTable("passes", 4)){
+            ImGui::TableSetupColumn("Pass"); ImGui::TableSetupColumn("CPU ms");
+            ImGui::TableSetupColumn("GPU ms"); ImGui::TableSetupColumn("History");
+            ImGui::TableHeadersRow();
+            for(int i=0;i<passCount;i++){
+                const Pass &ps = passes[i];
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn(); ImGui::Text("%*s%s", ps.depth*2, "", ps.name);
+                ImGui::TableNextColumn(); ImGui::Text("%.3f", ps.cpuMs);
+                ImGui::TableNextColumn(); if(ps.queries[0]) ImGui::Text("%.3f", ps.gpuMs); else ImGui::Text("-");
+                ImGui::TableNextColumn(); ImGui::PushID(i);
+                ImGui::PlotLines("##h", ps.history, HISTORY, historyPos, nullptr, 0.0f, FLT_MAX, ImVec2(120, 16));
+                ImGui::PopID();
+            }
+            ImGui::EndTable();
+        }
+        ImGui::Separator();
+        ImGui::Text("Draw calls: %llu", (unsigned long long)last.drawCalls);
+        ImGui::Text("Vertices drawn: %llu (%llu instances)", (unsigned long long)last.vertices, (unsigned long long)last.instances);
+        ImGui::Text("Bytes uploaded: %.1f KB", last.bytesUploaded/1024.0);
+        ImGui::Text("Allocations: %llu (%.1f KB, all threads)", (unsigned long long)last.allocations, last.allocBytes/1024.0);
+        if(extra) extra();
+        ImGui::Separator();
+        if(traceFramesLeft > 0) ImGui::Text("Recording trace... %d frames left", traceFramesLeft);
+        else if(ImGui::Button("Record Trace (120 frames)")) startTrace(120);
+        ImGui::End();
+    }
+
+    void startTrace(int frames){ trace.clear(); traceFramesLeft = frames; }
+    void writeTrace(){
+        FILE* f = fopen(tracePath.c_str(), "wb");
+        if(!f){ std::cerr<<"Profiler: cannot write "<<tracePath<<"\n"; return; }
+        fprintf(f, "{\"traceEvents\":[\n");
+        fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n");
+        fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}");
+        for(auto &e: trace)
+            fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", e.name, e.tid, e.startUs, e.durUs);
+        fprintf(f, "\n]}\n");
+        fclose(f);
+        std::cerr<<"Profiler: wrote "<<trace.size()<<" events to "<<tracePath<<"\n";
+        trace.clear();
+    }
+    void destroy(){
+        for(int i=0;i<passCount;i++) if(passes[i].queries[0]){ glDeleteQueries(GPU_LATENCY, passes[i].queries); passes[i].queries[0] = 0; }
+    }
+};
+static Profiler gProfiler;
+typedef Profiler::Scope ProfileScope;
+
 // ---------------------- Draw buffer ----------------------
+// 16-byte vertex: float position, RGBA8 normalized color, unorm16 texcoords.
+struct PackedVertex {
+    float x, y;
+    uint32_t rgba; // r in the lowest byte, matching GL_UNSIGNED_BYTE x4 in memory order
+    uint16_t u, v;
+};
+static_assert(sizeof(PackedVertex)==16, "PackedVertex must stay 16 bytes");
+
+static inline uint32_t packColor(float r,float g,float b,float a){
+    auto c = [](float f) -> uint32_t { f = f<0.0f ? 0.0f : (f>1.0f ? 1.0f : f); return (uint32_t)(f*255.0f + 0.5f); };
+    return c(r) | (c(g)<<8) | (c(b)<<16) | (c(a)<<24);
+}
+static inline uint32_t packColor(const glm::vec4 &c){ return packColor(c.r,c.g,c.b,c.a); }
+static inline glm::vec4 unpackColor(uint32_t c){
+    return glm::vec4((c & 0xFF)/255.0f, ((c>>8) & 0xFF)/255.0f, ((c>>16) & 0xFF)/255.0f, (c>>24)/255.0f);
+}
+static inline uint16_t packUnorm16(float f){
+    f = f<0.0f ? 0.0f : (f>1.0f ? 1.0f : f);
+    return (uint16_t)(f*65535.0f + 0.5f);
+}
+
+// Retained vertex data: one CPU copy, uploaded whole or patched by range. The VBO
+// grows to the next power of two when an upload does not fit.
 struct DrawBuffer {
-    std::vector<float> data; // x,y,r,g,b,a,u,v
+    static const size_t STRIDE = sizeof(PackedVertex);
+
+    std::vector<PackedVertex> data;
     GLuint vao=0, vbo=0;
     size_t vertexCount=0;
     GLuint texture=0; // store currently bound texture
+    size_t capacity=0;      // bytes of GPU storage
+
     void init(){
         glGenVertexArrays(1,&vao);
         glGenBuffers(1,&vbo);
         glBindVertexArray(vao);
         glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferData(GL_ARRAY_BUFFER, 1<<20, nullptr, GL_DYNAMIC_DRAW);
+        allocate(1<<20);
 
         // position
         glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0,2,GL_FLOAT,GL_FALSE,8*sizeof(float),(void*)0);
+        glVertexAttribPointer(0,2,GL_FLOAT,GL_FALSE,STRIDE,(void*)offsetof(PackedVertex,x));
 
-        // color
+        // color (RGBA8 -> vec4 in 0..1)
         glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1,4,GL_FLOAT,GL_FALSE,8*sizeof(float),(void*)(2*sizeof(float)));
+        glVertexAttribPointer(1,4,GL_UNSIGNED_BYTE,GL_TRUE,STRIDE,(void*)offsetof(PackedVertex,rgba));
 
-        // texcoords
+        // texcoords (unorm16 -> vec2 in 0..1)
         glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2,2,GL_FLOAT,GL_FALSE,8*sizeof(float),(void*)(6*sizeof(float)));
+        glVertexAttribPointer(2,2,GL_UNSIGNED_SHORT,GL_TRUE,STRIDE,(void*)offsetof(PackedVertex,u));
 
         glBindVertexArray(0);
     }
+    // (Re)allocates GPU storage; expects vbo bound. Old contents are dropped.
+    void allocate(size_t bytes){
+        capacity = bytes;
+        glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_STATIC_DRAW);
+    }
     void begin(){ data.clear(); vertexCount=0; }
+    // Vertex range patched in place since the last upload; see flushDirty().
+    size_t dirtyFirst = SIZE_MAX, dirtyEnd = 0;
+    void markDirty(size_t first, size_t count){ dirtyFirst = std::min(dirtyFirst, first); dirtyEnd = std::max(dirtyEnd, first+count); }
+    // Re-uploads only the patched range.
+    void flushDirty(){
+        if(dirtyFirst >= dirtyEnd) return;
+        gRecorder.forget(this);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferSubData(GL_ARRAY_BUFFER, dirtyFirst*STRIDE, (dirtyEnd-dirtyFirst)*STRIDE, data.data()+dirtyFirst);
+        gProfiler.frame.bytesUploaded += (dirtyEnd-dirtyFirst)*STRIDE;
+        dirtyFirst = SIZE_MAX; dirtyEnd = 0;
+    }
+    size_t gpuBytes() const { return capacity; }
+    // Reserves room for n more vertices so a batch of allocVertices calls never reallocates.
+    void reserveVertices(size_t n){ data.reserve(vertexCount+n); }
+    // Grows data by n vertices and returns where to write them.
+    PackedVertex* allocVertices(size_t n){
+        data.resize(vertexCount+n);
+        PackedVertex* out = data.data()+vertexCount;
+        vertexCount += n;
+        return out;
+    }
+    void pushVertex(float x,float y, uint32_t rgba, float u=0.0f, float v=0.0f){
+        *allocVertices(1) = PackedVertex{x, y, rgba, packUnorm16(u), packUnorm16(v)};
+    }
     void pushVertex(float x,float y, float r,float g,float b,float a, float u=0.0f, float v=0.0f){
-        data.push_back(x); data.push_back(y);
-        data.push_back(r); data.push_back(g); data.push_back(b); data.push_back(a);
-        data.push_back(u); data.push_back(v);
-        vertexCount++;
+        pushVertex(x, y, packColor(r,g,b,a), u, v);
     }
 
-    void uploadAndDrawTriangles(GLenum mode){
+    // Retained use: upload() once after building, then draw() every frame.
+    void upload(){
+        dirtyFirst = SIZE_MAX; dirtyEnd = 0;
+        gRecorder.forget(this);
         if(data.empty()) return;
+        size_t bytes = vertexCount*STRIDE;
+        gProfiler.frame.bytesUploaded += bytes;
         glBindBuffer(GL_ARRAY_BUFFER,vbo);
-        glBufferSubData(GL_ARRAY_BUFFER,0,data.size()*sizeof(float),data.data());
+        if(bytes > capacity){
+            size_t grown = capacity ? capacity : 1;
+            while(grown < bytes) grown *= 2;
+            allocate(grown);
+        }
+        glBufferSubData(GL_ARRAY_BUFFER,0,bytes,data.data());
+    }
+    void draw(GLenum mode, size_t first=0, size_t count=(size_t)-1){
+        if(count==(size_t)-1) count = vertexCount - first;
+        if(count==0) return;
         glBindVertexArray(vao);
-        if(texture) glBindTexture(GL_TEXTURE_2D, texture);
-        glDrawArrays(mode,0,(GLsizei)vertexCount);
+        if(texture) gGLState.bindTexture(GL_TEXTURE_2D, texture);
+        glDrawArrays(mode,(GLint)first,(GLsizei)count);
+        if(gRecorder.recording) gRecorder.drawArrays(this, data.data(), vertexCount*STRIDE, mode, first, count);
+        gProfiler.frame.drawCalls++; gProfiler.frame.vertices += count;
         glBindVertexArray(0);
-        glBindTexture(GL_TEXTURE_2D,0);
     }
-    void destroy(){ if(vbo) glDeleteBuffers(1,&vbo); if(vao) glDeleteVertexArrays(1,&vao); }
+    void destroy(){
+        if(vbo) glDeleteBuffers(1,&vbo);
+        if(vao) glDeleteVertexArrays(1,&vao);
+    }
 };
 
-////
-GLuint loadTexture(const char* path){
-    int w,h,n;
-    unsigned char* data = stbi_load(path, &w, &h, &n, 4);
-    if(!data){ std::cerr<<"Failed to load texture "<<path<<"\n"; return 0; }
-    GLuint tex;
-    glGenTextures(1,&tex);
-    glBindTexture(GL_TEXTURE_2D, tex);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA,w,h,0,GL_RGBA,GL_UNSIGNED_BYTE,data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    stbi_image_free(data);
-    return tex;
+// ---------------------- Unit circle table ----------------------
+// cos/sin of 2*pi*i/N built at compile time. Every circle and arc reads from here, so
+// the per-frame paths do no transcendental math; segment counts are powers of two so a
+// circle or quarter arc is just a strided walk over the table.
+constexpr int CIRCLE_TABLE_SIZE = 256;
+constexpr int CIRCLE_MIN_SEGMENTS = 8;
+constexpr int CIRCLE_MAX_SEGMENTS = 128;
+constexpr int CIRCLE_LOD_COUNT = 5; // 8,16,32,64,128
+
+constexpr double ctSin(double x){
+    while(x >  M_PI) x -= 2.0*M_PI;
+    while(x < -M_PI) x += 2.0*M_PI;
+    double term = x, sum = x;
+    for(int n=1;n<14;n++){ term *= -x*x / ((2.0*n)*(2.0*n+1.0)); sum += term; }
+    return sum;
+}
+struct UnitCircleTable { float c[CIRCLE_TABLE_SIZE+1]; float s[CIRCLE_TABLE_SIZE+1]; };
+constexpr UnitCircleTable makeUnitCircleTable(){
+    UnitCircleTable t{};
+    for(int i=0;i<=CIRCLE_TABLE_SIZE;i++){
+        double a = 2.0*M_PI*i/CIRCLE_TABLE_SIZE;
+        t.c[i] = (float)ctSin(a + M_PI/2.0);
+        t.s[i] = (float)ctSin(a);
+    }
+    return t;
 }
+static constexpr UnitCircleTable kUnitCircle = makeUnitCircleTable();
 
-// ---------------------- Geometry helpers ----------------------
-static void addRectTriangles(DrawBuffer &buf, float x, float y, float w, float h, glm::vec4 color){
-    buf.pushVertex(x, y, color.r, color.g, color.b, color.a);
-    buf.pushVertex(x+w, y, color.r, color.g, color.b, color.a);
-    buf.pushVertex(x+w, y+h, color.r, color.g, color.b, color.a);
-    buf.pushVertex(x, y, color.r, color.g, color.b, color.a);
-    buf.pushVertex(x+w, y+h, color.r, color.g, color.b, color.a);
-    buf.pushVertex(x, y+h, color.r, color.g, color.b, color.a);
-}
-static void addRectLines(DrawBuffer &buf, float x, float y, float w, float h, glm::vec4 color){
-    buf.pushVertex(x, y, color.r,color.g,color.b,color.a);
-    buf.pushVertex(x+w, y, color.r,color.g,color.b,color.a);
-    buf.pushVertex(x+w, y, color.r,color.g,color.b,color.a);
-    buf.pushVertex(x+w, y+h, color.r,color.g,color.b,color.a);
-    buf.pushVertex(x+w, y+h, color.r,color.g,color.b,color.a);
-    buf.pushVertex(x, y+h, color.r,color.g,color.b,color.a);
-    buf.pushVertex(x, y+h, color.r,color.g,color.b,color.a);
-    buf.pushVertex(x, y, color.r,color.g,color.b,color.a);
-}
-static void addCircleTriangles(DrawBuffer &buf, float cx, float cy, float r, int segments, glm::vec4 color){
-    for(int i=0;i<segments;i++){
-        float a1 = (float)i / segments * 2.0f * M_PI;
-        float a2 = (float)(i+1) / segments * 2.0f * M_PI;
-        buf.pushVertex(cx, cy, color.r,color.g,color.b,color.a);
-        buf.pushVertex(cx + cosf(a1)*r, cy + sinf(a1)*r, color.r,color.g,color.b,color.a);
-        buf.pushVertex(cx + cosf(a2)*r, cy + sinf(a2)*r, color.r,color.g,color.b,color.a);
-    }
-}
- void addRectTextured(DrawBuffer &buf, float x, float y, float w, float h, glm::vec4 color){
-    buf.pushVertex(x, y, color.r,color.g,color.b,color.a, 0.0f, 0.0f);
-    buf.pushVertex(x+w, y, color.r,color.g,color.b,color.a, 1.0f, 0.0f);
-    buf.pushVertex(x+w, y+h, color.r,color.g,color.b,color.a, 1.0f, 1.0f);
-
-    buf.pushVertex(x, y, color.r,color.g,color.b,color.a, 0.0f, 0.0f);
-    buf.pushVertex(x+w, y+h, color.r,color.g,color.b,color.a, 1.0f, 1.0f);
-    buf.pushVertex(x, y+h, color.r,color.g,color.b,color.a, 0.0f, 1.0f);
+// Segment count for a full circle of the given on-screen radius (pixels): the smallest
+// power of two whose chord sagitta stays under half a pixel (n >= pi*sqrt(r/(2*err))).
+static int circleLodLevel(float radiusPx){
+    const float maxError = 0.5f;
+    float needed = (float)M_PI * sqrtf(radiusPx / (2.0f*maxError));
+    int level = 0, segs = CIRCLE_MIN_SEGMENTS;
+    while(segs < needed && level < CIRCLE_LOD_COUNT-1){ segs *= 2; level++; }
+    return level;
 }
+static inline int circleSegmentsForLevel(int level){ return CIRCLE_MIN_SEGMENTS << level; }
+static inline int circleSegments(float radiusPx){ return circleSegmentsForLevel(circleLodLevel(radiusPx)); }
 
-// ---------------------- Floor plan structures ----------------------
-struct RectItem { 
-    float x,y,w,h; 
-    glm::vec4 color; 
-    std::string label;
-    std::string type = "A"; // "A" or "B" window type
-    GLuint texture = 0;
+// ---------------------- Instanced shapes ----------------------
+struct ShapeInstance {
+    float x, y, w, h;
+    uint32_t rgba;
+    int32_t layer; // texture layer, -1 for flat color
 };
 
-struct CircleItem { float x,y,r; glm::vec4 color; std::string label;GLuint texture = 0; };
-struct DoorItem { float x,y,w,h; std::string hinge; std::string label;GLuint texture = 0;};
-struct Vertex { glm::vec2 pos; glm::vec4 color; glm::vec2 uv; };
-// ---------------------- Elevation Parameters ----------------------
-static const float wallHeight   = 300.0f;  // cm or arbitrary units
-static const float doorHeight   = 220.0f;
-static const float windowHeight = 120.0f;
-static const float windowSill   = 90.0f;
+// Unit quad followed by one unit circle fan per LOD level in one static VBO.
+struct UnitMeshes {
+    GLuint vbo=0;
+    GLint quadFirst=0, quadCount=6;
+    GLint circleFirst[CIRCLE_LOD_COUNT]={}, circleCount[CIRCLE_LOD_COUNT]={};
+    void init(){
+        std::vector<float> v = {0,0, 1,0, 1,1, 0,0, 1,1, 0,1};
+        for(int l=0;l<CIRCLE_LOD_COUNT;l++){
+            int segments = circleSegmentsForLevel(l);
+            int stride = CIRCLE_TABLE_SIZE / segments;
+            circleFirst[l] = (GLint)(v.size()/2);
+            circleCount[l] = segments*3;
+            for(int i=0;i<CIRCLE_TABLE_SIZE;i+=stride)
+                v.insert(v.end(), {0.0f, 0.0f, kUnitCircle.c[i], kUnitCircle.s[i],
+                                   kUnitCircle.c[i+stride], kUnitCircle.s[i+stride]});
+        }
+        glGenBuffers(1,&vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, v.size()*sizeof(float), v.data(), GL_STATIC_DRAW);
+    }
+    void destroy(){ if(vbo) glDeleteBuffers(1,&vbo); }
+};
 
-    GLuint floorTexture = 0;
-    GLuint wallTexture = 0;
-    GLuint kitchenTexture = 0;
-    GLuint barTexture = 0;
-    GLuint tableTexture = 0;
-    GLuint doorTexture = 0; 
+// Per-instance attribute buffer drawn over one range of UnitMeshes.
+struct InstanceBuffer {
+    std::vector<ShapeInstance> data;
+    GLuint vao=0, vbo=0;
+    size_t capacity=0; // instances
+    GLint meshFirst=0, meshCount=0;
+    bool centered=false;
 
-struct FloorPlan {
-    bool showGrid = true;
-    bool showLabels = true;
-    bool showDoorSwings = true;
-    bool showDimensions = true;
-    bool showDrains=true;
-    bool showScaleBar=true;
-    float scaleX = 1.0f;
-    float scaleY = 1.0f;
-    bool showWindows = true;
-    bool showDoors = true;
-    bool showFrontElevation=false;
-    bool showSideElevation=true;
-    std::vector<RectItem> walls;
-    std::vector<RectItem> kitchen;
-    std::vector<RectItem> bar;
-    std::vector<RectItem> windows;
-    std::vector<RectItem> restrooms;
-    std::vector<RectItem> fire;
-    std::vector<RectItem> tablesRect;
-    std::vector<CircleItem> tablesCircle;
-    std::vector<DoorItem> doors;
-    std::vector<RectItem> floor;
-    std::vector<CircleItem>drains;
-    DrawBuffer triBuf;
-    DrawBuffer lineBuf;
-    glm::mat4 proj;
-    int canvasW=1200, canvasH=800;
-   
-    bool frontView = false;
-    float doorHeight = 210.0f;
-    float windowHeight = 120.0f;
+    void init(const UnitMeshes &mesh, GLint first, GLint count, bool isCentered){
+        meshFirst=first; meshCount=count; centered=isCentered;
+        glGenVertexArrays(1,&vao);
+        glGenBuffers(1,&vbo);
+        glBindVertexArray(vao);
 
- 
-   void init(int w,int h){
-        canvasW=w; canvasH=h;
-        triBuf.init(); lineBuf.init();
-        setupDefaultLayout();
-        updateProjection(w,h);
-    }
-    void setupDefaultLayout(){
-        floor.clear(); walls.clear(); kitchen.clear(); bar.clear(); windows.clear(); restrooms.clear();
-        fire.clear(); tablesRect.clear(); tablesCircle.clear(); doors.clear();drains.clear();
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0,2,GL_FLOAT,GL_FALSE,2*sizeof(float),(void*)0);
 
-        floor.push_back({50, 50, 1100, 700, glm::vec4(0.172f, 0.243f, 0.314f, 1.0f), "Floor"});
-        // --- Exterior wall ---
-        walls.push_back({50,50,15,700, glm::vec4(0.172f,0.243f,0.314f,1.0f), "Exterior Wall"});
-        walls.push_back({50,50,1100,15, glm::vec4(0.172f,0.243f,0.314f,1.0f), "Exterior Wall"});
-        walls.push_back({1135,50,15,700, glm::vec4(0.172f,0.243f,0.314f,1.0f), "Exterior Wall"});
-        walls.push_back({50,750,1100,15, glm::vec4(0.172f,0.243f,0.314f,1.0f), "Exterior Wall"});
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        capacity = 1024;
+        glBufferData(GL_ARRAY_BUFFER, capacity*sizeof(ShapeInstance), nullptr, GL_STATIC_DRAW);
+        GLsizei stride = sizeof(ShapeInstance);
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3,4,GL_FLOAT,GL_FALSE,stride,(void*)offsetof(ShapeInstance,x));
+        glVertexAttribDivisor(3,1);
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4,4,GL_UNSIGNED_BYTE,GL_TRUE,stride,(void*)offsetof(ShapeInstance,rgba));
+        glVertexAttribDivisor(4,1);
+        glEnableVertexAttribArray(5);
+        glVertexAttribIPointer(5,1,GL_INT,stride,(void*)offsetof(ShapeInstance,layer));
+        glVertexAttribDivisor(5,1);
 
-     
-   // --- Interior partition walls ---
-        walls.push_back({400, 50, 5, 350, glm::vec4(0.365f,0.427f,0.494f,1.0f), "Interior  Wall"});
-	walls.push_back({400, 470, 5, 295, glm::vec4(0.365f,0.427f,0.494f,1.0f), "Interior  Wall"});
-        walls.push_back({850, 450, 3, 300, glm::vec4(0.365f,0.427f,0.494f,1.0f), "Interior Walll"});
+        glBindVertexArray(0);
+    }
+    void begin(){ data.clear(); }
+    void push(float x,float y,float w,float h, uint32_t rgba, int32_t layer=-1){
+        data.push_back({x, y, w, h, rgba, layer});
+    }
+    void push(float x,float y,float w,float h, glm::vec4 color, int32_t layer=-1){
+        push(x, y, w, h, packColor(color), layer);
+    }
+    // Instance range patched in place since the last upload.
+    size_t dirtyFirst = SIZE_MAX, dirtyEnd = 0;
+    void markDirty(size_t first, size_t count){ dirtyFirst = std::min(dirtyFirst, first); dirtyEnd = std::max(dirtyEnd, first+count); }
+    void flushDirty(){
+        if(dirtyFirst >= dirtyEnd) return;
+        gRecorder.forget(this);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferSubData(GL_ARRAY_BUFFER, dirtyFirst*sizeof(ShapeInstance), (dirtyEnd-dirtyFirst)*sizeof(ShapeInstance), data.data()+dirtyFirst);
+        gProfiler.frame.bytesUploaded += (dirtyEnd-dirtyFirst)*sizeof(ShapeInstance);
+        dirtyFirst = SIZE_MAX; dirtyEnd = 0;
+    }
+    void upload(){
+        dirtyFirst = SIZE_MAX; dirtyEnd = 0;
+        gRecorder.forget(this);
+        if(data.empty()) return;
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        if(data.size() > capacity){
+            while(capacity < data.size()) capacity *= 2;
+            glBufferData(GL_ARRAY_BUFFER, capacity*sizeof(ShapeInstance), nullptr, GL_STATIC_DRAW);
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, 0, data.size()*sizeof(ShapeInstance), data.data());
+        gProfiler.frame.bytesUploaded += data.size()*sizeof(ShapeInstance);
+    }
+    // Expects the instanced program bound; uCentered picks the UV mapping for the mesh.
+    void draw(ShaderProgram &prog, int centeredSlot){ drawMesh(prog, centeredSlot, meshFirst, meshCount); }
+    // Same instances over another range of the unit meshes (the SDF path draws every
+    // shape on the unit quad).
+    void drawMesh(ShaderProgram &prog, int centeredSlot, GLint first, GLint count){
+        if(data.empty()) return;
+        prog.setInt(centeredSlot, centered);
+        glBindVertexArray(vao);
+        glDrawArraysInstanced(GL_TRIANGLES, first, count, (GLsizei)data.size());
+        if(gRecorder.recording) gRecorder.drawInstanced(this, data.data(), data.size()*sizeof(ShapeInstance), first, count, data.size());
+        gProfiler.frame.drawCalls++; gProfiler.frame.instances += data.size();
+        gProfiler.frame.vertices += (uint64_t)count*data.size();
+        glBindVertexArray(0);
+    }
+    void destroy(){
+        if(vbo) glDeleteBuffers(1,&vbo);
+        if(vao) glDeleteVertexArrays(1,&vao);
+    }
+};
 
+// ---------------------- Worker pool ----------------------
+// Fixed set of background threads for work that must stay off the render thread
+// (image decode, file IO). Jobs must not touch GL; they hand results back through
+// a queue the GL thread drains.
+struct WorkerPool {
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> jobs;
+    std::mutex m;
+    std::condition_variable cv;
+    bool stopping=false;
 
-        // --- Kitchen ---
-        kitchen.push_back({100,100,200,80, glm::vec4(0.5f,0.55f,0.55f,1.0f), "Preperation Area"});
-        kitchen.push_back({100,200,150,60, glm::vec4(0.906f,0.298f,0.196f,1.0f), "Cooking"});
-        kitchen.push_back({100,280,120,50, glm::vec4(0.204f,0.596f,0.859f,1.0f), "Sink"});
-        kitchen.push_back({280,100,80,40, glm::vec4(0.608f,0.353f,0.714f,1.0f), "Hand Wash"});
-        kitchen.push_back({100,350,250,120, glm::vec4(0.204f,0.255f,0.369f,1.0f), "Storeroom"});
+    void start(int count){
+        if(count<1) count=1;
+        for(int i=0;i<count;i++) threads.emplace_back([this]{ run(); });
+    }
+    void run(){
+        for(;;){
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv.wait(lock, [this]{ return stopping || !jobs.empty(); });
+                if(stopping) return;
+                job = std::move(jobs.front()); jobs.pop_front();
+            }
+            job();
+        }
+    }
+    void submit(std::function<void()> job){
+        if(threads.empty()){ job(); return; } // not started: run inline
+        { std::lock_guard<std::mutex> lock(m); jobs.push_back(std::move(job)); }
+        cv.notify_one();
+    }
+    // Lets running jobs finish and drops queued ones.
+    void stop(){
+        { std::lock_guard<std::mutex> lock(m); stopping=true; jobs.clear(); }
+        cv.notify_all();
+        for(auto &t: threads) t.join();
+        threads.clear();
+    }
+    ~WorkerPool(){ stop(); }
+};
+static WorkerPool gWorkers;
 
-	drains.push_back({150, 150, 6.0f, glm::vec4(0.0f,0.5f,1.0f,1.0f), "Drain 1"});
-	drains.push_back({200, 300, 6.0f, glm::vec4(0.0f,0.5f,1.0f,1.0f), "Drain 2"});
-	drains.push_back({300, 350, 6.0f, glm::vec4(0.0f,0.5f,1.0f,1.0f), "Drain 3"});
+// ---------------------- Redraw scheduling ----------------------
+// On-demand rendering: the main loop blocks in glfwWaitEvents until input, a resize or
+// a request() arrives, then draws a couple of frames (ImGui needs one more frame to
+// settle hover and layout) and sleeps again. Background jobs call request() when their
+// results are ready; glfwPostEmptyEvent is safe from any thread. Continuous mode draws
+// every iteration for animation and benchmarking.
+struct RedrawScheduler {
+    static const int SETTLE_FRAMES = 2;
+    bool continuous = false;
+    std::atomic<int> owed{SETTLE_FRAMES}; // frames still to draw before sleeping
 
-        // --- Bar counter ---
-        bar.push_back({935,100,25,250, glm::vec4(0.827f,0.329f,0.0f,1.0f), "Bar Counter"});
-	for(int i=0;i<5;i++)
-           tablesCircle.push_back({920.0f, 120.0f + i*50.0f, 6.0f, glm::vec4(0.902f,0.494f,0.133f,1.0f), ""});
-        // --- Windows ---
-        windows.push_back({200,50,150,10, glm::vec4(0.204f,0.596f,0.859f,1.0f), "Window","A"});
-        windows.push_back({700,50,200,10, glm::vec4(0.204f,0.596f,0.859f,1.0f), "Window","A"});
-        windows.push_back({50,200,10,100, glm::vec4(0.204f,0.596f,0.859f,1.0f), "Window",""});
-        windows.push_back({500,755,200,10, glm::vec4(0.204f,0.596f,0.859f,1.0f), "Window","C"});
-        windows.push_back({1110,70,40,60, glm::vec4(0.529f,0.808f,0.922f,1.0f), "Men's Toilet Window"});
-        windows.push_back({1110,170,40,60, glm::vec4(0.529f,0.808f,0.922f,1.0f), "Women's Toilet Window"});
+    void raise(int frames){
+        int cur = owed.load();
+        while(cur < frames && !owed.compare_exchange_weak(cur, frames)) {}
+    }
+    // Any thread.
+    void request(){ raise(SETTLE_FRAMES); glfwPostEmptyEvent(); }
+    // Processes pending events, blocking first if nothing is owed. timeout > 0 bounds the
+    // wait (e.g. a blinking text cursor); waking for any reason owes a redraw.
+    void waitEvents(double timeout){
+        if(continuous || owed.load() > 0){ glfwPollEvents(); return; }
+        if(timeout > 0.0) glfwWaitEventsTimeout(timeout);
+        else glfwWaitEvents();
+        raise(SETTLE_FRAMES);
+    }
+    // Decrements without going below zero, against a concurrent raise().
+    void frameDone(){
+        int cur = owed.load();
+        while(cur > 0 && !owed.compare_exchange_weak(cur, cur-1)) {}
+    }
+};
+static RedrawScheduler gRedraw;
 
-        // --- Restrooms ---
-        restrooms.push_back({1030,50,120,100, glm::vec4(0.608f,0.357f,0.714f,1.0f), "Men's"});
-        restrooms.push_back({1030,150,120,100, glm::vec4(0.608f,0.357f,0.714f,1.0f), "Women's"});
+// ---------------------- Job system ----------------------
+// Fork-join parallelism for frame work (geometry tessellation, overlay projection and
+// text measurement). Unlike gWorkers, these jobs are short and the submitting thread
+// waits for them, running jobs itself meanwhile. Every worker owns a deque: it pops its
+// newest job and, when empty, steals the oldest job of another queue, so a batch pushed
+// by one thread spreads over the pool. Jobs may call parallelFor themselves.
+struct JobSystem {
+    struct Job { const std::function<void(uint32_t)> *fn; uint32_t index; std::atomic<uint32_t> *pending; };
+    struct Queue { std::mutex m; std::deque<Job> jobs; };
+    std::vector<std::thread> threads;
+    std::unique_ptr<Queue[]> queues; // [0]: threads outside the pool, then one per worker
+    int queueCount = 0;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<int> queued{0};
+    std::atomic<bool> stopping{false};
+    static thread_local int self;    // queue of the calling thread
 
-        // --- Doors ---
-        doors.push_back({500,50,80,10, "Main Entrance"});
-        doors.push_back({50,600,10,50, "Back Door"});
-        doors.push_back({1135,350,10,80, "Emergency Exit"});
-        doors.push_back({400,400,10,70, "Side Door"});
-        // --- Fire Equipment ---
-        fire.push_back({390,230,12,20, glm::vec4(0.906f,0.298f,0.196f,1.0f), "Fire Extinguisher"});
-        fire.push_back({400,490,12,20, glm::vec4(0.906f,0.298f,0.196f,1.0f), "Fire Extinguisher"});
+    void start(int workers){
+        if(workers<1) return; // parallelFor then runs inline
+        stopping = false;
+        queueCount = workers + 1;
+        queues.reset(new Queue[queueCount]);
+        for(int i=1;i<queueCount;i++) threads.emplace_back([this, i]{ self = i; run(); });
+    }
+    // Threads a parallelFor can keep busy, for sizing its chunks.
+    int concurrency() const { return (int)threads.size() + 1; }
+
+    bool pop(int q, Job &job){
+        std::lock_guard<std::mutex> lock(queues[q].m);
+        if(queues[q].jobs.empty()) return false;
+        job = queues[q].jobs.back(); queues[q].jobs.pop_back();
+        queued--;
+        return true;
+    }
+    bool steal(int q, Job &job){
+        std::lock_guard<std::mutex> lock(queues[q].m);
+        if(queues[q].jobs.empty()) return false;
+        job = queues[q].jobs.front(); queues[q].jobs.pop_front();
+        queued--;
+        return true;
+    }
+    bool runOne(int q){
+        Job job;
+        bool found = pop(q, job);
+        for(int k=1;k<queueCount && !found;k++) found = steal((q+k)%queueCount, job);
+        if(!found) return false;
+        (*job.fn)(job.index);
+        job.pending->fetch_sub(1, std::memory_order_acq_rel);
+        return true;
+    }
+    void run(){
+        while(!stopping.load()){
+            if(runOne(self)) continue;
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [this]{ return stopping.load() || queued.load() > 0; });
+        }
+    }
+    // Calls fn(0) .. fn(count-1), spread over the pool; returns once all have finished.
+    void parallelFor(uint32_t count, const std::function<void(uint32_t)> &fn){
+        if(threads.empty() || count < 2){ for(uint32_t i=0;i<count;i++) fn(i); return; }
+        std::atomic<uint32_t> pending{count};
+        int q = self;
+        {
+            // Own pops take the back, so this thread starts at index 0 and thieves from the end.
+            std::lock_guard<std::mutex> lock(queues[q].m);
+            for(uint32_t i=count; i-- > 0;) queues[q].jobs.push_back({&fn, i, &pending});
+        }
+        queued += (int)count;
+        { std::lock_guard<std::mutex> lock(sleepMutex); }
+        wake.notify_all();
+        while(pending.load(std::memory_order_acquire) > 0)
+            if(!runOne(q)) std::this_thread::yield();
+    }
+    void stop(){
+        stopping = true;
+        { std::lock_guard<std::mutex> lock(sleepMutex); }
+        wake.notify_all();
+        for(auto &t: threads) t.join();
+        threads.clear();
+    }
+    ~JobSystem(){ stop(); }
+};
+thread_local int JobSystem::self = 0;
+static JobSystem gJobs;
+
+// ---------------------- Texture array ----------------------
+// All scene textures share one GL_TEXTURE_2D_ARRAY, one layer per material, so every
+// textured category can go through a single draw with the layer chosen per instance.
+enum TextureLayer { TEX_FLOOR, TEX_WALL, TEX_KITCHEN, TEX_BAR, TEX_TABLE, TEX_DOOR, TEX_LAYER_COUNT };
+
+// Bilinear resample of an RGBA8 image into a size x size layer.
+static void resampleRGBA(const unsigned char* src, int w, int h, unsigned char* dst, int size){
+    for(int y=0;y<size;y++){
+        float fy = ((y+0.5f)*h/size) - 0.5f; if(fy<0) fy=0;
+        int y0 = (int)fy, y1 = y0+1<h ? y0+1 : h-1; float ty = fy-y0;
+        for(int x=0;x<size;x++){
+            float fx = ((x+0.5f)*w/size) - 0.5f; if(fx<0) fx=0;
+            int x0 = (int)fx, x1 = x0+1<w ? x0+1 : w-1; float tx = fx-x0;
+            const unsigned char *p00=src+(y0*w+x0)*4, *p10=src+(y0*w+x1)*4, *p01=src+(y1*w+x0)*4, *p11=src+(y1*w+x1)*4;
+            for(int c=0;c<4;c++){
+                float top = p00[c] + (p10[c]-p00[c])*tx;
+                float bot = p01[c] + (p11[c]-p01[c])*tx;
+                dst[(y*size+x)*4+c] = (unsigned char)(top + (bot-top)*ty + 0.5f);
+            }
+        }
+    }
+}
+
+// 2x2 box filter: one mip level down from a size x size RGBA8 image.
+static void downsampleRGBA(const unsigned char* src, int size, unsigned char* dst){
+    int half = size > 1 ? size/2 : 1;
+    for(int y=0;y<half;y++) for(int x=0;x<half;x++) for(int c=0;c<4;c++){
+        int x0=x*2, y0=y*2, x1=x0+1<size?x0+1:x0, y1=y0+1<size?y0+1:y0;
+        int sum = src[(y0*size+x0)*4+c] + src[(y0*size+x1)*4+c] + src[(y1*size+x0)*4+c] + src[(y1*size+x1)*4+c];
+        dst[(y*half+x)*4+c] = (unsigned char)((sum+2)/4);
+    }
+}
+
+// ---------------------- Texture cache ----------------------
+// Processed layers (compressed, full mip chain) are kept in .texcache/<hash>.rtc, keyed
+// by source path and validated against the source's mtime, so later launches skip JPEG
+// decode, resampling and mip generation and upload with glCompressedTexSubImage3D.
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+
+static const char* TEXCACHE_DIR = ".texcache";
+static const uint32_t TEXCACHE_MAGIC = 0x31435452; // "RTC1"
+static const uint32_t TEXCACHE_VERSION = 1;
+
+struct TexCacheHeader {
+    uint32_t magic, version;
+    uint32_t format;      // GL compressed internal format
+    uint32_t size;        // level 0 width == height
+    uint32_t levels;
+    uint32_t reserved;
+    int64_t  sourceMtime;
+};
+
+static std::string texCachePath(const std::string &source){
+    uint64_t h = 1469598103934665603ull; // FNV-1a
+    for(unsigned char c: source){ h ^= c; h *= 1099511628211ull; }
+    char name[64]; snprintf(name, sizeof(name), "%s/%016llx.rtc", TEXCACHE_DIR, (unsigned long long)h);
+    return name;
+}
+static bool sourceMtime(const std::string &path, int64_t &out){
+    struct stat st;
+    if(stat(path.c_str(), &st)!=0) return false;
+    out = (int64_t)st.st_mtime;
+    return true;
+}
+static bool readTexCache(const std::string &source, uint32_t format, uint32_t size,
+                         std::vector<std::vector<unsigned char>> &levels){
+    int64_t mtime;
+    if(!sourceMtime(source, mtime)) return false;
+    FILE* f = fopen(texCachePath(source).c_str(), "rb");
+    if(!f) return false;
+    TexCacheHeader hdr;
+    bool ok = fread(&hdr,sizeof(hdr),1,f)==1 && hdr.magic==TEXCACHE_MAGIC && hdr.version==TEXCACHE_VERSION
+           && hdr.format==format && hdr.size==size && hdr.sourceMtime==mtime && hdr.levels>0 && hdr.levels<=16;
+    if(ok){
+        levels.resize(hdr.levels);
+        for(auto &lv: levels){
+            uint32_t bytes=0;
+            if(fread(&bytes,sizeof(bytes),1,f)!=1 || bytes>(64u<<20)){ ok=false; break; }
+            lv.resize(bytes);
+            if(fread(lv.data(),1,bytes,f)!=bytes){ ok=false; break; }
+        }
+    }
+    fclose(f);
+    return ok;
+}
+static void writeTexCache(const std::string &source, uint32_t format, uint32_t size,
+                          const std::vector<std::vector<unsigned char>> &levels){
+    TexCacheHeader hdr{TEXCACHE_MAGIC, TEXCACHE_VERSION, format, size, (uint32_t)levels.size(), 0, 0};
+    if(!sourceMtime(source, hdr.sourceMtime)) return;
+#ifdef _WIN32
+    _mkdir(TEXCACHE_DIR);
+#else
+    mkdir(TEXCACHE_DIR, 0755);
+#endif
+    std::string path = texCachePath(source), tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if(!f){ std::cerr<<"Texture cache: cannot write "<<tmp<<"\n"; return; }
+    bool ok = fwrite(&hdr,sizeof(hdr),1,f)==1;
+    for(auto &lv: levels){
+        uint32_t bytes = (uint32_t)lv.size();
+        ok = ok && fwrite(&bytes,sizeof(bytes),1,f)==1 && fwrite(lv.data(),1,bytes,f)==bytes;
+    }
+    fclose(f);
+    if(ok) rename(tmp.c_str(), path.c_str()); // readers never see a partial file
+    else remove(tmp.c_str());
+}
+
+// Layers decode on gWorkers and reach the GPU later through pumpUploads() on the GL
+// thread; until then layer() reports -1 and items draw in their flat color. When the
+// driver offers DXT1 the array is stored compressed: cache hits upload as-is, misses
+// are compressed once by the driver through a scratch texture and written to the cache.
+struct TextureArray {
+    static const int LAYER_SIZE = 512;
+    GLuint tex=0;
+    GLuint pbo=0;
+    GLuint scratch=0;             // 2D texture the driver compresses cache misses into
+    GLenum internalFormat=GL_RGBA8;
+    int levelCount=1;
+    bool loaded[TEX_LAYER_COUNT] = {};
+
+    struct DecodedLayer {
+        int layer;
+        bool compressed;                              // levels already in internalFormat
+        std::vector<std::vector<unsigned char>> levels; // full mip chain
+        std::string source;
+    };
+    std::mutex readyMutex;
+    std::vector<DecodedLayer> ready; // decoded, waiting for upload
+    std::atomic<int> pending{0};     // layers still decoding or queued
+
+    // Layer to sample for a material, or -1 (flat color) while it is loading or if its
+    // file failed to load.
+    int layer(TextureLayer l) const { return loaded[l] ? (int)l : -1; }
+    bool busy() const { return pending.load() > 0; }
+    bool isCompressed() const { return internalFormat != GL_RGBA8; }
+
+    static bool driverSupportsFormat(GLenum fmt){
+        GLint n=0; glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &n);
+        std::vector<GLint> formats(n>0 ? n : 0);
+        if(n>0) glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats.data());
+        for(GLint f: formats) if((GLenum)f==fmt) return true;
+        return false;
+    }
+
+    void load(const char* const paths[TEX_LAYER_COUNT]){
+        if(driverSupportsFormat(GL_COMPRESSED_RGB_S3TC_DXT1_EXT)) internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        levelCount = 1;
+        for(int sz=LAYER_SIZE; sz>1; sz/=2) levelCount++;
+
+        glGenTextures(1,&tex);
+        gGLState.bindTexture(GL_TEXTURE_2D_ARRAY, tex);
+        for(int l=0, sz=LAYER_SIZE; l<levelCount; l++, sz = sz>1 ? sz/2 : 1)
+            glTexImage3D(GL_TEXTURE_2D_ARRAY,l,internalFormat,sz,sz,TEX_LAYER_COUNT,0,GL_RGBA,GL_UNSIGNED_BYTE,nullptr);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levelCount-1);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glGenBuffers(1,&pbo);
+        if(isCompressed()) glGenTextures(1,&scratch);
+
+        const uint32_t format = internalFormat;
+        for(int i=0;i<TEX_LAYER_COUNT;i++){
+            pending++;
+            std::string path = paths[i];
+            gWorkers.submit([this, i, path, format]{
+                DecodedLayer d{i, false, {}, path};
+                // A cache entry with a different mip chain can't fill this array's levels:
+                // decode the source instead of leaving the layer empty.
+                if(format!=GL_RGBA8 && readTexCache(path, format, LAYER_SIZE, d.levels) && (int)d.levels.size()==levelCount){
+                    d.compressed = true;
+                } else {
+                    d.levels.clear();
+                    int w,h,n;
+                    unsigned char* data = stbi_load(path.c_str(), &w, &h, &n, 4);
+                    if(!data){ std::cerr<<"Failed to load texture "<<path<<"\n"; pending--; return; }
+                    d.levels.emplace_back((size_t)LAYER_SIZE*LAYER_SIZE*4);
+                    resampleRGBA(data, w, h, d.levels[0].data(), LAYER_SIZE);
+                    stbi_image_free(data);
+                    for(int sz=LAYER_SIZE; sz>1; sz/=2){
+                        d.levels.emplace_back((size_t)(sz/2)*(sz/2)*4);
+                        downsampleRGBA(d.levels[d.levels.size()-2].data(), sz, d.levels.back().data());
+                    }
+                }
+                { std::lock_guard<std::mutex> lock(readyMutex); ready.push_back(std::move(d)); }
+                gRedraw.request(); // pumpUploads() runs on the next frame
+            });
+        }
+    }
+
+    // Has the driver compress one level through the scratch texture and reads it back.
+    // Empty if the driver reports no compressed size.
+    std::vector<unsigned char> compressLevel(const std::vector<unsigned char> &rgba, int sz){
+        gGLState.bindTexture(GL_TEXTURE_2D, scratch);
+        glTexImage2D(GL_TEXTURE_2D,0,internalFormat,sz,sz,0,GL_RGBA,GL_UNSIGNED_BYTE,rgba.data());
+        GLint bytes=0;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D,0,GL_TEXTURE_COMPRESSED_IMAGE_SIZE,&bytes);
+        std::vector<unsigned char> out(bytes>0 ? bytes : 0);
+        if(bytes>0) glGetCompressedTexImage(GL_TEXTURE_2D,0,out.data());
+        return out;
+    }
+
+    // GL thread: streams decoded layers into the array through the PBO. Returns true if
+    // any layer became available (instances need their layer indices refreshed).
+    // Cache misses compress and read back every mip synchronously, so at most one of
+    // them is handled per call; the rest wait for the next frame.
+    bool pumpUploads(){
+        std::vector<DecodedLayer> batch, deferred;
+        { std::lock_guard<std::mutex> lock(readyMutex); batch.swap(ready); }
+        if(batch.empty()) return false;
+
+        bool compressedOne = false, uploaded = false;
+        for(auto &d: batch){
+            if(isCompressed() && !d.compressed){
+                if(compressedOne){ deferred.push_back(std::move(d)); continue; }
+                compressedOne = true;
+                std::vector<std::vector<unsigned char>> packed(d.levels.size());
+                bool ok = true;
+                for(int l=0, sz=LAYER_SIZE; l<(int)d.levels.size() && ok; l++, sz/=2){
+                    packed[l] = compressLevel(d.levels[l], sz);
+                    ok = !packed[l].empty();
+                }
+                // On failure the RGBA levels go up as-is and the driver compresses them;
+                // nothing is cached, so the next run tries again.
+                if(ok){
+                    d.levels.swap(packed);
+                    d.compressed = true;
+                    std::string source = d.source;
+                    auto levels = d.levels;
+                    uint32_t format = internalFormat;
+                    gWorkers.submit([source, format, levels]{ writeTexCache(source, format, LAYER_SIZE, levels); });
+                }
+            }
+            uploaded = true;
+            if((int)d.levels.size()!=levelCount){ pending--; continue; }
+
+            size_t total=0;
+            for(auto &lv: d.levels) total += lv.size();
+            gGLState.bindTexture(GL_TEXTURE_2D_ARRAY, tex);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+            // Orphan so the driver hands back fresh storage instead of waiting on the last copy.
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, total, nullptr, GL_STREAM_DRAW);
+            unsigned char* dst = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, total, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+            if(dst){
+                for(auto &lv: d.levels){ memcpy(dst, lv.data(), lv.size()); dst += lv.size(); }
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                size_t offset=0;
+                for(int l=0, sz=LAYER_SIZE; l<levelCount; l++, sz = sz>1 ? sz/2 : 1){
+                    GLsizei bytes = (GLsizei)d.levels[l].size();
+                    if(d.compressed)
+                        glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY,l,0,0,d.layer,sz,sz,1,internalFormat,bytes,(void*)offset);
+                    else
+                        glTexSubImage3D(GL_TEXTURE_2D_ARRAY,l,0,0,d.layer,sz,sz,1,GL_RGBA,GL_UNSIGNED_BYTE,(void*)offset);
+                    offset += bytes;
+                }
+                loaded[d.layer] = true;
+            }
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            pending--;
+        }
+        if(!deferred.empty()){
+            std::lock_guard<std::mutex> lock(readyMutex);
+            for(auto &d: deferred) ready.push_back(std::move(d));
+            gRedraw.request();
+        }
+        return uploaded;
+    }
+    void destroy(){
+        if(tex || scratch) gGLState.invalidate();
+        if(tex) glDeleteTextures(1,&tex);
+        if(scratch) glDeleteTextures(1,&scratch);
+        if(pbo) glDeleteBuffers(1,&pbo);
+        tex=0; scratch=0; pbo=0;
+    }
+};
+// Material layers shared by every floor; loaded once by the first FloorPlan::loadTextures.
+static TextureArray gSceneTextures;
+
+// ---------------------- Geometry helpers ----------------------
+// segments must be a power of two between CIRCLE_MIN_SEGMENTS and CIRCLE_TABLE_SIZE.
+static void emitCircle(PackedVertex *v, float cx, float cy, float r, int segments, uint32_t c){
+    int stride = CIRCLE_TABLE_SIZE / segments;
+    for(int i=0;i<CIRCLE_TABLE_SIZE;i+=stride){
+        *v++ = {cx, cy, c, 0, 0};
+        *v++ = {cx + kUnitCircle.c[i]*r, cy + kUnitCircle.s[i]*r, c, 0, 0};
+        *v++ = {cx + kUnitCircle.c[i+stride]*r, cy + kUnitCircle.s[i+stride]*r, c, 0, 0};
+    }
+}
+static void addCircleTriangles(DrawBuffer &buf, float cx, float cy, float r, int segments, uint32_t c){
+    emitCircle(buf.allocVertices((size_t)segments*3), cx, cy, r, segments, c);
+}
+// ---------------------- Batched rect kernel ----------------------
+// Column pointers of a rect store; the kernel reads items idx[0..n) from them.
+struct RectSpan { const float *x, *y, *w, *h; const uint32_t *rgba; };
+enum RectEmit { RECT_FILL, RECT_TEXTURED, RECT_OUTLINE };
+constexpr size_t rectEmitVertices(RectEmit e){ return e==RECT_OUTLINE ? 8 : 6; }
+
+// Writes rectEmitVertices(kind)*n vertices to out, which the caller has sized. Uses
+// the item colour unless itemColor is false, in which case every rect gets `color`.
+// A PackedVertex is exactly 16 bytes, so on SSE2 each vertex is one 128-bit store:
+// the corner position in the low half and colour|uv in the high half.
+static void emitRects(PackedVertex *out, const RectSpan &s, const uint32_t *idx, size_t n,
+                      RectEmit kind, bool itemColor, uint32_t color){
+    // uv words (u | v<<16) per corner for the textured variant
+    const uint32_t UV00 = 0, UV10 = 0xFFFFu, UV11 = 0xFFFFFFFFu, UV01 = 0xFFFF0000u;
+    const bool tex = kind==RECT_TEXTURED;
+#if FLOORPLAN_SSE2
+    float *dst = reinterpret_cast<float*>(out);
+    for(size_t k=0;k<n;k++){
+        uint32_t i = idx[k];
+        int c = (int)(itemColor ? s.rgba[i] : color);
+        __m128 q = _mm_add_ps(_mm_setr_ps(s.x[i], s.y[i], s.x[i], s.y[i]),
+                              _mm_setr_ps(0.0f, 0.0f, s.w[i], s.h[i]));         // x0 y0 x1 y1
+        __m128 p00 = q;
+        __m128 p10 = _mm_shuffle_ps(q, q, _MM_SHUFFLE(3,3,1,2));                 // x1 y0
+        __m128 p11 = _mm_movehl_ps(q, q);                                        // x1 y1
+        __m128 p01 = _mm_shuffle_ps(q, q, _MM_SHUFFLE(3,3,3,0));                 // x0 y1
+        auto attr = [&](uint32_t uv){ return _mm_castsi128_ps(_mm_setr_epi32(c, tex ? (int)uv : 0, 0, 0)); };
+        __m128 v00 = _mm_movelh_ps(p00, attr(UV00)), v10 = _mm_movelh_ps(p10, attr(UV10));
+        __m128 v11 = _mm_movelh_ps(p11, attr(UV11)), v01 = _mm_movelh_ps(p01, attr(UV01));
+        if(kind==RECT_OUTLINE){
+            _mm_storeu_ps(dst+ 0, v00); _mm_storeu_ps(dst+ 4, v10);
+            _mm_storeu_ps(dst+ 8, v10); _mm_storeu_ps(dst+12, v11);
+            _mm_storeu_ps(dst+16, v11); _mm_storeu_ps(dst+20, v01);
+            _mm_storeu_ps(dst+24, v01); _mm_storeu_ps(dst+28, v00);
+            dst += 32;
+        } else {
+            _mm_storeu_ps(dst+ 0, v00); _mm_storeu_ps(dst+ 4, v10);
+            _mm_storeu_ps(dst+ 8, v11); _mm_storeu_ps(dst+12, v00);
+            _mm_storeu_ps(dst+16, v11); _mm_storeu_ps(dst+20, v01);
+            dst += 24;
+        }
+    }
+#else
+    auto vert = [&](float x, float y, uint32_t c, uint32_t uv){
+        if(!tex) uv = 0;
+        return PackedVertex{x, y, c, (uint16_t)(uv & 0xFFFF), (uint16_t)(uv >> 16)};
+    };
+    PackedVertex *v = out;
+    for(size_t k=0;k<n;k++){
+        uint32_t i = idx[k];
+        uint32_t c = itemColor ? s.rgba[i] : color;
+        float x0 = s.x[i], y0 = s.y[i], x1 = x0 + s.w[i], y1 = y0 + s.h[i];
+        PackedVertex a = vert(x0,y0,c,UV00), b = vert(x1,y0,c,UV10), d = vert(x1,y1,c,UV11), e = vert(x0,y1,c,UV01);
+        if(kind==RECT_OUTLINE){
+            v[0]=a; v[1]=b; v[2]=b; v[3]=d; v[4]=d; v[5]=e; v[6]=e; v[7]=a; v += 8;
+        } else {
+            v[0]=a; v[1]=b; v[2]=d; v[3]=a; v[4]=d; v[5]=e; v += 6;
+        }
+    }
+#endif
+}
+// Appends the rects idx[0..n) of one store to buf with a single allocation.
+static void addRects(DrawBuffer &buf, const RectSpan &s, const std::vector<uint32_t> &idx,
+                     RectEmit kind, bool itemColor=true, uint32_t color=0){
+    if(idx.empty()) return;
+    emitRects(buf.allocVertices(idx.size()*rectEmitVertices(kind)), s, idx.data(), idx.size(), kind, itemColor, color);
+}
+
+// ---------------------- Overlay pass ----------------------
+// The plan projection is a pure 2D scale + translate, so world->screen reduces to
+// screen = world*scale + offset, derived once per frame from proj and the canvas size.
+struct ScreenTransform {
+    float ax=1, bx=0, ay=1, by=0;
+    float width=0, height=0;
+
+    static ScreenTransform fromProjection(const glm::mat4 &proj, int canvasW, int canvasH){
+        // NDC -> pixels with y flipped, folded into the orthographic matrix (no rotation,
+        // w == 1, so the perspective divide and the mat4*vec4 both drop out).
+        ScreenTransform t;
+        t.width = (float)canvasW; t.height = (float)canvasH;
+        t.ax =  proj[0][0]*0.5f*t.width;  t.bx = (proj[3][0]*0.5f + 0.5f)*t.width;
+        t.ay = -proj[1][1]*0.5f*t.height; t.by = (0.5f - proj[3][1]*0.5f)*t.height;
+        return t;
+    }
+    ImVec2 apply(float wx, float wy) const { return ImVec2(wx*ax + bx, wy*ay + by); }
+};
+
+enum OverlayKind : uint8_t { OV_DOOR_SWING, OV_DRAIN, OV_DIMENSION_H, OV_DIMENSION_V, OV_SCALE_BAR, OV_LABEL };
+static inline int overlayAnchorCount(OverlayKind k){
+    return (k==OV_DIMENSION_H || k==OV_DIMENSION_V || k==OV_SCALE_BAR) ? 2 : 1;
+}
+
+// Cached text measurement, stored on the item that owns the text. Re-measured only when
+// the font size (i.e. scaleX) changes: labels are immutable once a row is inserted, and
+// insert() gives every new row a fresh layout.
+struct TextLayout {
+    float fontSize = 0.0f; // size it was measured at; 0 = not measured
+    ImVec2 size;
+
+    const ImVec2 &measure(ImFont* font, float fs, const char* text){
+        if(fontSize != fs){ size = font->CalcTextSizeA(fs, FLT_MAX, 0.0f, text); fontSize = fs; }
+        return size;
+    }
+};
+// A dimension's formatted value plus its measurement; re-formatted when the value changes.
+struct DimLayout {
+    float value = -1.0f;
+    char text[16] = "";
+    TextLayout layout;
+
+    const char* format(float v){
+        if(v != value){ snprintf(text, sizeof(text), "%.0f", v); value = v; layout.fontSize = 0.0f; }
+        return text;
+    }
+};
+
+struct OverlayItem {
+    OverlayKind kind;
+    uint32_t anchor;  // first of overlayAnchorCount(kind) anchors
+    float size;       // world radius (swings, drains) or the measured value (dimensions)
+    ImU32 color;
+    const char* text; // label owned by the plan items; valid for the frame
+    TextLayout* layout = nullptr; // item's cached measurement of text
+    DimLayout* dim = nullptr;     // item's cached dimension string
+    uint8_t priority = 0;         // labels: LabelPriority
+};
+
+// floor(v) clamped to [lo, hi] in float, so huge, infinite or NaN coordinates (the mouse
+// off-window is -FLT_MAX) never reach an out-of-range float-to-int conversion. NaN gives lo.
+static inline int floorToCell(float v, int lo, int hi){
+    v = floorf(v);
+    if(!(v >= (float)lo)) return lo;
+    return v < (float)hi ? (int)v : hi;
+}
+
+// Screen-space occupancy grid for label placement: each cell lists the placed label
+// rects overlapping it, so a collision test only looks at nearby labels.
+struct LabelGrid {
+    static constexpr float CELL = 32.0f;
+    int cols=0, rows=0;
+    std::vector<int> head;            // per cell: first node, -1 = empty
+    std::vector<int> nodeRect, nodeNext;
+    std::vector<ImVec4> rects;        // placed rects (x0,y0,x1,y1)
+
+    void reset(float width, float height){
+        cols = (int)(width/CELL)+1; rows = (int)(height/CELL)+1;
+        head.assign((size_t)cols*rows, -1);
+        nodeRect.clear(); nodeNext.clear(); rects.clear();
+    }
+    void cellRange(const ImVec4 &r, int &cx0, int &cy0, int &cx1, int &cy1) const {
+        cx0 = floorToCell(r.x/CELL, 0, cols-1); cy0 = floorToCell(r.y/CELL, 0, rows-1);
+        cx1 = floorToCell(r.z/CELL, 0, cols-1); cy1 = floorToCell(r.w/CELL, 0, rows-1);
+    }
+    bool isFree(const ImVec4 &r) const {
+        int cx0,cy0,cx1,cy1; cellRange(r,cx0,cy0,cx1,cy1);
+        for(int cy=cy0;cy<=cy1;cy++) for(int cx=cx0;cx<=cx1;cx++)
+            for(int n=head[cy*cols+cx]; n>=0; n=nodeNext[n]){
+                const ImVec4 &o = rects[nodeRect[n]];
+                if(r.x < o.z && o.x < r.z && r.y < o.w && o.y < r.w) return false;
+            }
+        return true;
+    }
+    void insert(const ImVec4 &r){
+        int id = (int)rects.size(); rects.push_back(r);
+        int cx0,cy0,cx1,cy1; cellRange(r,cx0,cy0,cx1,cy1);
+        for(int cy=cy0;cy<=cy1;cy++) for(int cx=cx0;cx<=cx1;cx++){
+            int &h = head[cy*cols+cx];
+            nodeRect.push_back(id); nodeNext.push_back(h); h = (int)nodeRect.size()-1;
+        }
+    }
+};
+
+// Label priorities: lower wins a contested spot.
+enum LabelPriority : uint8_t { LP_EXIT, LP_WALL, LP_SAFETY, LP_ROOM, LP_FIXTURE, LP_FURNITURE, LP_CHAIR };
+
+// Collects every overlay's world anchors for one frame, projects them in a single pass
+// and draws only items whose anchors all land inside the viewport.
+struct OverlayPass {
+    ScreenTransform xf;
+    float pixelScale = 1.0f; // scaleX: line widths, fonts and radii
+    std::vector<float> wx, wy;
+    std::vector<ImVec2> screen;
+    std::vector<uint8_t> visible;
+    std::vector<OverlayItem> items;
+    // Label placement: labels that would overlap a higher-priority one are shifted
+    // above/below their anchor or dropped.
+    bool declutter = true;
+    LabelGrid labelGrid;
+    std::vector<uint32_t> labelOrder;
+    std::vector<ImVec2> labelPos; // per item: placed text position
+    std::vector<uint8_t> labelShown;
+    float reach = 0.0f; // widest extent of any item around its anchors, set by prepare
+
+    void begin(const ScreenTransform &t, float scale){
+        xf = t; pixelScale = scale;
+        wx.clear(); wy.clear(); items.clear();
+    }
+    OverlayItem &add(OverlayKind kind, float size, ImU32 color, const char* text, float x0, float y0, float x1=0.0f, float y1=0.0f){
+        items.push_back({kind, (uint32_t)wx.size(), size, color, text});
+        wx.push_back(x0); wy.push_back(y0);
+        if(overlayAnchorCount(kind)==2){ wx.push_back(x1); wy.push_back(y1); }
+        return items.back();
+    }
+    static constexpr uint32_t PARALLEL_GRAIN = 4096; // anchors or items per job
+    void project(){
+        size_t n = wx.size();
+        screen.resize(n); visible.resize(n);
+        const float ax=xf.ax, bx=xf.bx, ay=xf.ay, by=xf.by, w=xf.width, h=xf.height;
+        gJobs.parallelFor((uint32_t)((n + PARALLEL_GRAIN - 1) / PARALLEL_GRAIN), [&](uint32_t job){
+            size_t end = std::min(n, (size_t)(job+1)*PARALLEL_GRAIN);
+            for(size_t i=(size_t)job*PARALLEL_GRAIN;i<end;i++){
+                float x = wx[i]*ax + bx, y = wy[i]*ay + by;
+                screen[i] = ImVec2(x, y);
+                visible[i] = x>=0.0f && x<=w && y>=0.0f && y<=h;
+            }
+        });
+    }
+    // Fills the text caches of every visible item before placement and drawing need
+    // them. Each item owns its layouts, so jobs never share one. From Dear ImGui 1.92
+    // fonts bake glyphs lazily inside CalcTextSizeA, so there it stays on this thread.
+    void measure(ImFont* font){
+        const float sx = pixelScale;
+        auto measureItem = [&](OverlayItem &it){
+            if(!itemVisible(it)) return;
+            if(it.kind==OV_LABEL) it.layout->measure(font, 14.0f * sx, it.text);
+            else if(it.kind==OV_DRAIN && it.text) it.layout->measure(font, 12.0f * sx, it.text);
+            else if(it.dim) it.dim->layout.measure(font, 12.0f * sx, it.dim->format(it.size));
+        };
+#if defined(IMGUI_VERSION_NUM) && IMGUI_VERSION_NUM < 19200
+        size_t n = items.size();
+        gJobs.parallelFor((uint32_t)((n + PARALLEL_GRAIN - 1) / PARALLEL_GRAIN), [&](uint32_t job){
+            size_t end = std::min(n, (size_t)(job+1)*PARALLEL_GRAIN);
+            for(size_t i=(size_t)job*PARALLEL_GRAIN;i<end;i++) measureItem(items[i]);
+        });
+#else
+        for(auto &it: items) measureItem(it);
+#endif
+    }
+    bool itemVisible(const OverlayItem &it) const {
+        for(int k=0;k<overlayAnchorCount(it.kind);k++) if(!visible[it.anchor+k]) return false;
+        return true;
+    }
+
+    // Decides where (and whether) each visible label is drawn. Labels are placed in
+    // priority order; each tries its centred spot, then one line above, then one below.
+    void placeLabels(ImFont* font, float fontSize){
+        labelPos.resize(items.size());
+        labelShown.assign(items.size(), 0);
+        labelOrder.clear();
+        for(uint32_t i=0;i<items.size();i++)
+            if(items[i].kind==OV_LABEL && itemVisible(items[i])) labelOrder.push_back(i);
+        std::stable_sort(labelOrder.begin(), labelOrder.end(),
+            [&](uint32_t a, uint32_t b){ return items[a].priority < items[b].priority; });
+        labelGrid.reset(xf.width, xf.height);
+
+        for(uint32_t i: labelOrder){
+            const OverlayItem &it = items[i];
+            ImVec2 p0 = screen[it.anchor];
+            ImVec2 textSize = it.layout->measure(font, fontSize, it.text);
+            ImVec2 centred(p0.x - textSize.x*0.5f, p0.y - textSize.y*0.5f);
+            if(!declutter){ labelPos[i] = centred; labelShown[i] = 1; continue; }
+            const float offsets[3] = {0.0f, -(textSize.y+4.0f), textSize.y+4.0f};
+            for(float dy: offsets){
+                ImVec2 pos(centred.x, centred.y + dy);
+                ImVec4 r(pos.x-4, pos.y-2, pos.x+textSize.x+4, pos.y+textSize.y+2);
+                if(r.z < 0.0f || r.x > xf.width || r.w < 0.0f || r.y > xf.height) continue; // off-screen
+                if(!labelGrid.isFree(r)) continue;
+                labelGrid.insert(r);
+                labelPos[i] = pos; labelShown[i] = 1;
+                break;
+            }
+        }
+    }
+
+    // Measures text and places labels for the projected items; draw() may then run
+    // any number of times (export draws one prepared pass into every tile).
+    void prepare(ImFont* font){
+        measure(font);
+        placeLabels(font, 14.0f * pixelScale);
+        reach = 0.0f;
+        for(auto &it: items){
+            if(it.kind==OV_LABEL) reach = std::max(reach, it.layout->size.x);
+            else if(it.kind==OV_DOOR_SWING || it.kind==OV_DRAIN) reach = std::max(reach, it.size * pixelScale);
+        }
+        reach += 40.0f * pixelScale; // text boxes, arrow heads, the scale bar caption
+    }
+    void flush(ImDrawList* draw_list){
+        ImFont* font = ImGui::GetFont();
+        prepare(font);
+        draw(draw_list, font, ImVec2(0.0f, 0.0f), ImVec4(-FLT_MAX, -FLT_MAX, FLT_MAX, FLT_MAX));
+    }
+    // Emits the prepared items shifted by `offset`, skipping those whose anchors are
+    // further than `reach` outside `clip` (x0,y0,x1,y1, in pass coordinates).
+    void draw(ImDrawList* draw_list, ImFont* font, ImVec2 offset, const ImVec4 &clip){
+        const float sx = pixelScale;
+        const ImU32 textBg = IM_COL32(255,255,255,200), black = IM_COL32(0,0,0,255);
+        const ImVec4 keep(clip.x - reach, clip.y - reach, clip.z + reach, clip.w + reach);
+        for(size_t idx=0; idx<items.size(); idx++){
+            const OverlayItem &it = items[idx];
+            if(!itemVisible(it)) continue;
+            ImVec2 s0 = screen[it.anchor], s1 = overlayAnchorCount(it.kind)==2 ? screen[it.anchor+1] : s0;
+            if(std::max(s0.x, s1.x) < keep.x || std::min(s0.x, s1.x) > keep.z || std::max(s0.y, s1.y) < keep.y || std::min(s0.y, s1.y) > keep.w) continue;
+            ImVec2 p0(s0.x + offset.x, s0.y + offset.y);
+            switch(it.kind){
+            case OV_DOOR_SWING: {
+                float radius = it.size * sx; // scale radius relative to world units
+                // 90-degree swing: the first quarter of the unit circle table
+                int stride = CIRCLE_TABLE_SIZE / circleSegments(radius);
+                const int quarter = CIRCLE_TABLE_SIZE / 4;
+                for (int i = 0; i < quarter; i += stride) {
+                    ImVec2 a(p0.x + kUnitCircle.c[i] * radius, p0.y + kUnitCircle.s[i] * radius);
+                    ImVec2 b(p0.x + kUnitCircle.c[i+stride] * radius, p0.y + kUnitCircle.s[i+stride] * radius);
+                    draw_list->AddLine(p0, a, it.color, 2.0f * sx);
+                    draw_list->AddLine(a, b, it.color, 2.0f * sx);
+                }
+                break;
+            }
+            case OV_DRAIN: {
+                draw_list->AddCircleFilled(p0, it.size*sx, it.color, 12);
+                if (it.text) {
+                    ImVec2 textSize = it.layout->measure(font, 12.0f * sx, it.text);
+                    ImVec2 textPos(p0.x - textSize.x*0.5f, p0.y - it.size*sx - textSize.y - 2);
+                    draw_list->AddRectFilled(ImVec2(textPos.x-2, textPos.y-1), ImVec2(textPos.x+textSize.x+2, textPos.y+textSize.y+1), textBg);
+                    draw_list->AddText(font, 12.0f * sx, textPos, black, it.text);
+                }
+                break;
+            }
+            case OV_DIMENSION_H:
+            case OV_DIMENSION_V: {
+                ImVec2 p1(s1.x + offset.x, s1.y + offset.y);
+                float arrowSize = 5.0f * sx;
+                draw_list->AddLine(p0, p1, it.color, 1.5f);
+                draw_list->AddLine(p0, ImVec2(p0.x+arrowSize,p0.y+arrowSize), it.color, 1.5f);
+                draw_list->AddLine(p1, ImVec2(p1.x-arrowSize,p1.y-arrowSize), it.color, 1.5f);
+                const char* buf = it.dim->format(it.size);
+                ImVec2 textSize = it.dim->layout.measure(font, 12.0f * sx, buf);
+                ImVec2 textPos = it.kind==OV_DIMENSION_H
+                    ? ImVec2((p0.x+p1.x-textSize.x)*0.5f, p0.y - textSize.y*0.5f)
+                    : ImVec2(p0.x - textSize.x*0.5f, (p0.y+p1.y-textSize.y)*0.5f);
+                draw_list->AddRectFilled(ImVec2(textPos.x-2,textPos.y-1), ImVec2(textPos.x+textSize.x+2,textPos.y+textSize.y+1), textBg);
+                draw_list->AddText(font, 12.0f * sx, textPos, black, buf); // scale font size with window
+                break;
+            }
+            case OV_SCALE_BAR: {
+                ImVec2 p1(s1.x + offset.x, s1.y + offset.y);
+                draw_list->AddLine(p0, p1, it.color, 2.0f * sx);
+                draw_list->AddText(font, 14.0f * sx, ImVec2(p0.x, p0.y - 20.0f*sx), it.color, it.text);
+                break;
+            }
+            case OV_LABEL: {
+                if(!labelShown[idx]) break;
+                ImVec2 textSize = it.layout->measure(font, 14.0f * sx, it.text); // cached by prepare
+                ImVec2 textPos(labelPos[idx].x + offset.x, labelPos[idx].y + offset.y);
+                draw_list->AddRectFilled(ImVec2(textPos.x-4,textPos.y-2),
+                                         ImVec2(textPos.x+textSize.x+4,textPos.y+textSize.y+2),
+                                         textBg);
+                draw_list->AddText(font, 14.0f * sx, textPos, it.color, it.text);
+                break;
+            }
+            }
+        }
+    }
+};
+
+// ---------------------- Floor plan structures ----------------------
+// Authoring rows: what setupDefaultLayout (and later loaders) push into the item stores.
+struct RectItem {
+    float x,y,w,h;
+    glm::vec4 color;
+    std::string label;
+    std::string type = "A"; // "A" or "B" window type
+};
+struct CircleItem { float x,y,r; glm::vec4 color; std::string label; };
+struct DoorItem { float x,y,w,h; std::string hinge; std::string label; };
+
+// Interned strings. Id 0 is the empty string; the deque keeps references stable as
+// the table grows, so item views can hand out `const std::string &`.
+struct StringTable {
+    std::deque<std::string> strings{std::string()};
+    std::unordered_map<std::string, uint32_t> ids{{std::string(), 0u}};
+    uint32_t intern(const std::string &s){
+        auto it = ids.find(s);
+        if(it != ids.end()) return it->second;
+        uint32_t id = (uint32_t)strings.size();
+        strings.push_back(s);
+        ids.emplace(strings.back(), id);
+        return id;
+    }
+    const std::string &str(uint32_t id) const { return strings[id]; }
+    size_t size() const { return strings.size(); }
+    void clear(){ strings.assign(1, std::string()); ids.clear(); ids.emplace(std::string(), 0u); }
+};
+
+// Item column: either owned, or a borrowed view into a mapped layout file. The first
+// mutation of a borrowed column copies it (copy-on-write), so loaded layouts are used
+// in place until edited.
+template<class T> struct Column {
+    using value_type = T;
+    std::vector<T> owned;
+    const T *view = nullptr;
+    size_t viewCount = 0;
+
+    size_t size() const { return view ? viewCount : owned.size(); }
+    bool empty() const { return size()==0; }
+    const T *data() const { return view ? view : owned.data(); }
+    const T &operator[](size_t i) const { return data()[i]; }
+    bool borrowed() const { return view != nullptr; }
+    void borrow(const T *p, size_t n){ owned.clear(); view = p; viewCount = n; }
+    std::vector<T> &mut(){
+        if(view){ owned.assign(view, view+viewCount); view = nullptr; viewCount = 0; }
+        return owned;
+    }
+    void set(size_t i, const T &v){ mut()[i] = v; }
+    void insert(size_t i, const T &v){ auto &m = mut(); m.insert(m.begin()+i, v); }
+    void erase(size_t i){ auto &m = mut(); m.erase(m.begin()+i); }
+    void push_back(const T &v){ mut().push_back(v); }
+    void clear(){ owned.clear(); view = nullptr; viewCount = 0; }
+};
+
+// Index-based iterator over a store; dereferencing builds a lightweight row view.
+template<class Store> struct StoreIterator {
+    const Store *store; uint32_t i;
+    auto operator*() const { return (*store)[i]; }
+    StoreIterator &operator++(){ ++i; return *this; }
+    bool operator!=(const StoreIterator &o) const { return i != o.i; }
+};
+
+// ---------------------- Item stores (SoA) ----------------------
+// One store per category. Hot geometry is kept in contiguous columns so geometry
+// generation and culling stream only what they read; labels are string-table ids and
+// the overlay text caches live in separate cold columns.
+struct RectView {
+    const float &x, &y, &w, &h;
+    uint32_t rgba;
+    const std::string &label, &type;
+    TextLayout &labelLayout;
+    DimLayout *dimLayout; // [0] width, [1] height
+    glm::vec4 color() const { return unpackColor(rgba); }
+};
+struct RectStore {
+    StringTable *strings;
+    Column<float> x, y, w, h;
+    Column<uint32_t> rgba;
+    Column<uint32_t> label, type; // StringTable ids
+    mutable std::vector<TextLayout> labelLayout;
+    mutable std::vector<std::array<DimLayout,2>> dimLayout;
+
+    explicit RectStore(StringTable *st) : strings(st) {}
+    size_t size() const { return x.size(); }
+    bool empty() const { return x.empty(); }
+    void clear(){ x.clear(); y.clear(); w.clear(); h.clear(); rgba.clear(); label.clear(); type.clear(); labelLayout.clear(); dimLayout.clear(); }
+    void resizeCold(){ labelLayout.assign(size(), TextLayout()); dimLayout.assign(size(), {}); }
+    RectSpan span() const { return {x.data(), y.data(), w.data(), h.data(), rgba.data()}; }
+    void push_back(const RectItem &r){ insert(size(), r); }
+    void insert(size_t i, const RectItem &r){
+        x.insert(i, r.x); y.insert(i, r.y); w.insert(i, r.w); h.insert(i, r.h);
+        rgba.insert(i, packColor(r.color));
+        label.insert(i, strings->intern(r.label)); type.insert(i, strings->intern(r.type));
+        labelLayout.emplace(labelLayout.begin()+i); dimLayout.emplace(dimLayout.begin()+i);
+    }
+    void erase(size_t i){
+        x.erase(i); y.erase(i); w.erase(i); h.erase(i); rgba.erase(i); label.erase(i); type.erase(i);
+        labelLayout.erase(labelLayout.begin()+i); dimLayout.erase(dimLayout.begin()+i);
+    }
+    RectItem row(size_t i) const { return {x[i], y[i], w[i], h[i], unpackColor(rgba[i]), strings->str(label[i]), strings->str(type[i])}; }
+    RectView operator[](size_t i) const {
+        return {x[i], y[i], w[i], h[i], rgba[i], strings->str(label[i]), strings->str(type[i]), labelLayout[i], dimLayout[i].data()};
+    }
+    StoreIterator<RectStore> begin() const { return {this, 0}; }
+    StoreIterator<RectStore> end() const { return {this, (uint32_t)size()}; }
+};
+
+struct CircleView {
+    const float &x, &y, &r;
+    uint32_t rgba;
+    const std::string &label;
+    TextLayout &labelLayout;  // 14px plan label
+    TextLayout &markerLayout; // 12px caption above a drain marker
+    glm::vec4 color() const { return unpackColor(rgba); }
+};
+struct CircleStore {
+    StringTable *strings;
+    Column<float> x, y, r;
+    Column<uint32_t> rgba, label;
+    mutable std::vector<TextLayout> labelLayout, markerLayout;
+
+    explicit CircleStore(StringTable *st) : strings(st) {}
+    size_t size() const { return x.size(); }
+    bool empty() const { return x.empty(); }
+    void clear(){ x.clear(); y.clear(); r.clear(); rgba.clear(); label.clear(); labelLayout.clear(); markerLayout.clear(); }
+    void resizeCold(){ labelLayout.assign(size(), TextLayout()); markerLayout.assign(size(), TextLayout()); }
+    void push_back(const CircleItem &c){ insert(size(), c); }
+    void insert(size_t i, const CircleItem &c){
+        x.insert(i, c.x); y.insert(i, c.y); r.insert(i, c.r);
+        rgba.insert(i, packColor(c.color)); label.insert(i, strings->intern(c.label));
+        labelLayout.emplace(labelLayout.begin()+i); markerLayout.emplace(markerLayout.begin()+i);
+    }
+    void erase(size_t i){
+        x.erase(i); y.erase(i); r.erase(i); rgba.erase(i); label.erase(i);
+        labelLayout.erase(labelLayout.begin()+i); markerLayout.erase(markerLayout.begin()+i);
+    }
+    CircleItem row(size_t i) const { return {x[i], y[i], r[i], unpackColor(rgba[i]), strings->str(label[i])}; }
+    CircleView operator[](size_t i) const {
+        return {x[i], y[i], r[i], rgba[i], strings->str(label[i]), labelLayout[i], markerLayout[i]};
+    }
+    StoreIterator<CircleStore> begin() const { return {this, 0}; }
+    StoreIterator<CircleStore> end() const { return {this, (uint32_t)size()}; }
+};
+
+struct DoorView {
+    const float &x, &y, &w, &h;
+    const std::string &hinge, &label;
+    TextLayout &labelLayout;
+};
+struct DoorStore {
+    StringTable *strings;
+    Column<float> x, y, w, h;
+    Column<uint32_t> hinge, label;
+    mutable std::vector<TextLayout> labelLayout;
+
+    explicit DoorStore(StringTable *st) : strings(st) {}
+    size_t size() const { return x.size(); }
+    bool empty() const { return x.empty(); }
+    void clear(){ x.clear(); y.clear(); w.clear(); h.clear(); hinge.clear(); label.clear(); labelLayout.clear(); }
+    void resizeCold(){ labelLayout.assign(size(), TextLayout()); }
+    void push_back(const DoorItem &d){ insert(size(), d); }
+    void insert(size_t i, const DoorItem &d){
+        x.insert(i, d.x); y.insert(i, d.y); w.insert(i, d.w); h.insert(i, d.h);
+        hinge.insert(i, strings->intern(d.hinge)); label.insert(i, strings->intern(d.label));
+        labelLayout.emplace(labelLayout.begin()+i);
+    }
+    void erase(size_t i){
+        x.erase(i); y.erase(i); w.erase(i); h.erase(i); hinge.erase(i); label.erase(i);
+        labelLayout.erase(labelLayout.begin()+i);
+    }
+    DoorItem row(size_t i) const { return {x[i], y[i], w[i], h[i], strings->str(hinge[i]), strings->str(label[i])}; }
+    DoorView operator[](size_t i) const {
+        return {x[i], y[i], w[i], h[i], strings->str(hinge[i]), strings->str(label[i]), labelLayout[i]};
+    }
+    StoreIterator<DoorStore> begin() const { return {this, 0}; }
+    StoreIterator<DoorStore> end() const { return {this, (uint32_t)size()}; }
+};
+
+// ---------------------- Spatial index ----------------------
+// Item categories in draw order (later = on top); an ItemRef names one item of a
+// FloorPlan category vector.
+enum ItemCategory : uint8_t {
+    CAT_FLOOR, CAT_WALL, CAT_KITCHEN, CAT_BAR, CAT_WINDOW, CAT_RESTROOM, CAT_FIRE,
+    CAT_DOOR, CAT_TABLE_RECT, CAT_TABLE_CIRCLE, CAT_DRAIN, CAT_COUNT, CAT_NONE = 0xFF
+};
+struct ItemRef {
+    uint8_t cat = CAT_NONE;
+    uint32_t index = 0;
+    bool valid() const { return cat != CAT_NONE; }
+    bool operator==(const ItemRef &o) const { return cat==o.cat && index==o.index; }
+};
+
+struct ItemBounds {
+    float x0=0, y0=0, x1=0, y1=0;
+    bool intersects(const ItemBounds &o) const { return x0 <= o.x1 && o.x0 <= x1 && y0 <= o.y1 && o.y0 <= y1; }
+    bool contains(float x, float y) const { return x >= x0 && x <= x1 && y >= y0 && y <= y1; }
+    bool contains(const ItemBounds &o) const { return o.x0 >= x0 && o.x1 <= x1 && o.y0 >= y0 && o.y1 <= y1; }
+    ItemBounds expanded(float m) const { return {x0-m, y0-m, x1+m, y1+m}; }
+};
+
+// Uniform grid over item bounds. Each cell lists the items overlapping it; items outside
+// the grid extent are clamped into the border cells, so every item is always findable.
+// Updates are incremental (remove from the old cells, insert into the new ones).
+struct SpatialGrid {
+    float cell = 50.0f;
+    float ox = 0.0f, oy = 0.0f;
+    int cols = 1, rows = 1;
+    std::vector<std::vector<ItemRef>> cells;
+    std::vector<ItemBounds> bounds[CAT_COUNT]; // indexed bounds per item
+    std::vector<uint8_t> present[CAT_COUNT];
+    std::vector<uint32_t> stamp[CAT_COUNT];    // per-query dedupe
+    uint32_t queryStamp = 0;
+
+    void reset(const ItemBounds &extent, float cellSize){
+        cell = cellSize; ox = extent.x0; oy = extent.y0;
+        cols = std::max(1, (int)ceilf((extent.x1-extent.x0)/cell));
+        rows = std::max(1, (int)ceilf((extent.y1-extent.y0)/cell));
+        cells.assign((size_t)cols*rows, {});
+        for(int c=0;c<CAT_COUNT;c++){ bounds[c].clear(); present[c].clear(); stamp[c].clear(); }
+    }
+    void cellRange(const ItemBounds &b, int &cx0, int &cy0, int &cx1, int &cy1) const {
+        cx0 = floorToCell((b.x0-ox)/cell, 0, cols-1);
+        cy0 = floorToCell((b.y0-oy)/cell, 0, rows-1);
+        cx1 = floorToCell((b.x1-ox)/cell, 0, cols-1);
+        cy1 = floorToCell((b.y1-oy)/cell, 0, rows-1);
+    }
+    void insert(ItemRef r, const ItemBounds &b){
+        auto &bv = bounds[r.cat];
+        if(bv.size() <= r.index){ bv.resize(r.index+1); present[r.cat].resize(r.index+1, 0); stamp[r.cat].resize(r.index+1, 0); }
+        bv[r.index] = b; present[r.cat][r.index] = 1;
+        int cx0,cy0,cx1,cy1; cellRange(b,cx0,cy0,cx1,cy1);
+        for(int cy=cy0;cy<=cy1;cy++) for(int cx=cx0;cx<=cx1;cx++) cells[cy*cols+cx].push_back(r);
+    }
+    void remove(ItemRef r){
+        if(r.index >= present[r.cat].size() || !present[r.cat][r.index]) return;
+        int cx0,cy0,cx1,cy1; cellRange(bounds[r.cat][r.index],cx0,cy0,cx1,cy1);
+        for(int cy=cy0;cy<=cy1;cy++) for(int cx=cx0;cx<=cx1;cx++){
+            auto &c = cells[cy*cols+cx];
+            for(size_t k=0;k<c.size();k++) if(c[k]==r){ c[k]=c.back(); c.pop_back(); break; }
+        }
+        present[r.cat][r.index] = 0;
+    }
+    void update(ItemRef r, const ItemBounds &b){ remove(r); insert(r, b); }
+
+    // Calls fn(ItemRef, const ItemBounds&) once for every item whose bounds touch q.
+    template<class F> void query(const ItemBounds &q, F &&fn){
+        if(++queryStamp == 0){ for(auto &st: stamp) std::fill(st.begin(), st.end(), 0); queryStamp = 1; }
+        int cx0,cy0,cx1,cy1; cellRange(q,cx0,cy0,cx1,cy1);
+        for(int cy=cy0;cy<=cy1;cy++) for(int cx=cx0;cx<=cx1;cx++)
+            for(const ItemRef &r: cells[cy*cols+cx]){
+                uint32_t &st = stamp[r.cat][r.index];
+                if(st == queryStamp) continue;
+                st = queryStamp;
+                const ItemBounds &b = bounds[r.cat][r.index];
+                if(b.intersects(q)) fn(r, b);
+            }
+    }
+};
+
+// ---------------------- Camera ----------------------
+// World point shown at the canvas centre plus a zoom factor relative to "fit the
+// 1200x800 design space into the canvas".
+struct Camera {
+    float cx = 600.0f, cy = 400.0f;
+    float zoom = 1.0f;
+    static constexpr float kMinZoom = 0.25f, kMaxZoom = 16.0f;
+};
+
+// Level-of-detail thresholds on the on-screen scale (pixels per world unit).
+constexpr float LOD_FINE_DETAIL_SCALE = 0.55f; // below: chairs, drains and sofa outlines drop out
+constexpr float LOD_GRID_SCALE = 0.35f;        // below: the 50-unit grid is too dense to read
+
+// ---------------------- Layout files ----------------------
+// Binary layout (.fplan): header, then per category the item columns as flat 4-byte
+// arrays (16-byte aligned), then the string table as u32 offsets + one blob. Columns
+// are used in place from the mapping. Little-endian, like every target we ship on.
+static const uint32_t LAYOUT_MAGIC = 0x4E4C5046; // "FPLN"
+static const uint32_t LAYOUT_VERSION = 1;
+static const int LAYOUT_MAX_COLUMNS = 8;
+
+// Stored name and column count per category, in ItemCategory order.
+static const char *const kCategoryNames[CAT_COUNT] = {
+    "floor", "walls", "kitchen", "bar", "windows", "restrooms", "fire",
+    "doors", "tablesRect", "tablesCircle", "drains"
+};
+
+struct LayoutSection {
+    uint32_t count;
+    uint32_t columnCount;
+    uint64_t columnAt[LAYOUT_MAX_COLUMNS]; // byte offsets from the start of the file
+};
+struct LayoutFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t categoryCount;
+    uint32_t stringCount;
+    uint64_t stringOffsetsAt; // u32[stringCount+1], relative to stringBlobAt
+    uint64_t stringBlobAt;
+    uint64_t fileSize;
+    LayoutSection sections[CAT_COUNT];
+};
+
+// Read-only file mapping (whole-file read where mmap is unavailable).
+struct MappedFile {
+    const unsigned char *data = nullptr;
+    size_t size = 0;
+    std::vector<unsigned char> buffer; // owned bytes: Windows reads, adopt()
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile &operator=(const MappedFile&) = delete;
+    ~MappedFile(){ close(); }
+    void swap(MappedFile &o){
+        std::swap(data, o.data); std::swap(size, o.size);
+        buffer.swap(o.buffer);
+    }
+    // Takes bytes already in memory (a layout embedded in a frame capture).
+    void adopt(std::vector<unsigned char> &&bytes){
+        close();
+        buffer = std::move(bytes);
+        data = buffer.data(); size = buffer.size();
+    }
+    bool open(const std::string &path){
+        close();
+#ifdef _WIN32
+        FILE* f = fopen(path.c_str(), "rb");
+        if(!f) return false;
+        fseek(f, 0, SEEK_END); long n = ftell(f); fseek(f, 0, SEEK_SET);
+        buffer.resize(n > 0 ? (size_t)n : 0);
+        bool ok = n > 0 && fread(buffer.data(), 1, buffer.size(), f)==buffer.size();
+        fclose(f);
+        if(!ok){ buffer.clear(); return false; }
+        data = buffer.data(); size = buffer.size();
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if(fd < 0) return false;
+        struct stat st;
+        if(fstat(fd, &st) != 0 || st.st_size <= 0){ ::close(fd); return false; }
+        void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // the mapping keeps the file referenced
+        if(p == MAP_FAILED) return false;
+        data = (const unsigned char*)p; size = (size_t)st.st_size;
+#endif
+        return true;
+    }
+    void close(){
+#ifndef _WIN32
+        if(data && buffer.empty()) munmap((void*)data, size);
+#endif
+        buffer.clear();
+        data = nullptr; size = 0;
+    }
+};
+
+// Minimal JSON reader for layout import: objects, arrays, strings, numbers, literals.
+struct JsonValue {
+    enum Type { NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT } type = NUL;
+    double number = 0.0;
+    std::string str;
+    std::vector<JsonValue> items;                           // ARRAY
+    std::vector<std::pair<std::string, JsonValue>> members; // OBJECT
+
+    const JsonValue *get(const char *key) const {
+        for(auto &m: members) if(m.first == key) return &m.second;
+        return nullptr;
+    }
+    float num(const char *key, float def=0.0f) const { auto* v = get(key); return v && v->type==NUMBER ? (float)v->number : def; }
+    std::string text(const char *key, const char *def="") const { auto* v = get(key); return v && v->type==STRING ? v->str : std::string(def); }
+};
+struct JsonParser {
+    const char *p, *end;
+    std::string error;
+
+    void ws(){ while(p<end && (*p==' '||*p=='\t'||*p=='\n'||*p=='\r')) p++; }
+    bool fail(const char *msg){ if(error.empty()) error = msg; return false; }
+    // Exactly four hex digits after a \\u.
+    bool hex4(unsigned &cp){
+        if(end-p < 4) return false;
+        cp = 0;
+        for(int i=0;i<4;i++){
+            char h = *p++;
+            unsigned d = h>='0'&&h<='9' ? h-'0' : h>='a'&&h<='f' ? h-'a'+10 : h>='A'&&h<='F' ? h-'A'+10 : 16;
+            if(d==16) return false;
+            cp = cp*16 + d;
+        }
+        return true;
+    }
+    // One value and nothing after it but whitespace.
+    bool parseDocument(JsonValue &v){
+        if(!parseValue(v)) return false;
+        ws();
+        return p==end || fail("unexpected data after the root value");
+    }
+    bool parseString(std::string &out){
+        if(p>=end || *p!='"') return fail("expected string");
+        p++;
+        while(p<end && *p!='"'){
+            char c = *p++;
+            if(c!='\\'){ out += c; continue; }
+            if(p>=end) return fail("bad escape");
+            char e = *p++;
+            switch(e){
+            case 'n': out += '\n'; break; case 't': out += '\t'; break;
+            case 'r': out += '\r'; break; case 'b': out += '\b'; break; case 'f': out += '\f'; break;
+            case 'u': {
+                unsigned cp;
+                if(!hex4(cp)) return fail("bad \\u escape");
+                if(cp >= 0xDC00 && cp <= 0xDFFF) return fail("unpaired surrogate in \\u escape");
+                if(cp >= 0xD800 && cp <= 0xDBFF){ // UTF-16 pair: the low half must follow
+                    unsigned lo;
+                    if(end-p < 2 || p[0]!='\\' || p[1]!='u') return fail("unpaired surrogate in \\u escape");
+                    p += 2;
+                    if(!hex4(lo)) return fail("bad \\u escape");
+                    if(lo < 0xDC00 || lo > 0xDFFF) return fail("unpaired surrogate in \\u escape");
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                }
+                if(cp < 0x80) out += (char)cp;
+                else if(cp < 0x800){ out += (char)(0xC0|(cp>>6)); out += (char)(0x80|(cp&0x3F)); }
+                else if(cp < 0x10000){ out += (char)(0xE0|(cp>>12)); out += (char)(0x80|((cp>>6)&0x3F)); out += (char)(0x80|(cp&0x3F)); }
+                else { out += (char)(0xF0|(cp>>18)); out += (char)(0x80|((cp>>12)&0x3F)); out += (char)(0x80|((cp>>6)&0x3F)); out += (char)(0x80|(cp&0x3F)); }
+                break;
+            }
+            case '"': case '\\': case '/': out += e; break;
+            default: return fail("invalid escape");
+            }
+        }
+        if(p>=end) return fail("unterminated string");
+        p++;
+        return true;
+    }
+    bool parseValue(JsonValue &v, int depth=0){
+        if(depth > 64) return fail("nesting too deep");
+        ws();
+        if(p>=end) return fail("unexpected end");
+        if(*p=='{'){
+            v.type = JsonValue::OBJECT; p++; ws();
+            if(p<end && *p=='}'){ p++; return true; }
+            for(;;){
+                ws();
+                std::pair<std::string, JsonValue> m;
+                if(!parseString(m.first)) return false;
+                ws();
+                if(p>=end || *p!=':') return fail("expected ':'");
+                p++;
+                if(!parseValue(m.second, depth+1)) return false;
+                v.members.push_back(std::move(m));
+                ws();
+                if(p<end && *p==','){ p++; continue; }
+                if(p<end && *p=='}'){ p++; return true; }
+                return fail("expected ',' or '}'");
+            }
+        }
+        if(*p=='['){
+            v.type = JsonValue::ARRAY; p++; ws();
+            if(p<end && *p==']'){ p++; return true; }
+            for(;;){
+                v.items.emplace_back();
+                if(!parseValue(v.items.back(), depth+1)) return false;
+                ws();
+                if(p<end && *p==','){ p++; continue; }
+                if(p<end && *p==']'){ p++; return true; }
+                return fail("expected ',' or ']'");
+            }
+        }
+        if(*p=='"'){ v.type = JsonValue::STRING; return parseString(v.str); }
+        auto lit = [&](const char *w){ size_t n = strlen(w); if((size_t)(end-p) >= n && !strncmp(p, w, n)){ p += n; return true; } return false; };
+        if(lit("true")){ v.type = JsonValue::BOOL; v.number = 1; return true; }
+        if(lit("false")){ v.type = JsonValue::BOOL; return true; }
+        if(lit("null")) return true;
+        // Strict JSON number: -?(0|[1-9]\d*)(\.\d+)?([eE][+-]?\d+)?
+        const char *q = p;
+        auto digits = [&]{ const char *d = q; while(q<end && isdigit((unsigned char)*q)) q++; return q > d; };
+        if(q<end && *q=='-') q++;
+        if(q<end && *q=='0') q++;
+        else if(!(q<end && *q>='1' && *q<='9') || !digits()) return fail(q==p ? "unexpected character" : "bad number");
+        if(q<end && *q=='.'){ q++; if(!digits()) return fail("bad number"); }
+        if(q<end && (*q=='e' || *q=='E')){
+            q++;
+            if(q<end && (*q=='+' || *q=='-')) q++;
+            if(!digits()) return fail("bad number");
+        }
+        size_t used = q - p;
+        std::string text(p, used);
+        char *stop = nullptr;
+        v.number = strtod(text.c_str(), &stop);
+        if(stop != text.c_str() + used) return fail("bad number");
+        if(!std::isfinite(v.number)) return fail("number out of range"); // 1e999 would load as inf
+        p += used; v.type = JsonValue::NUMBER;
+        return true;
+    }
+};
+static void jsonEscape(std::string &out, const std::string &s){
+    out += '"';
+    for(char c: s){
+        if(c=='"' || c=='\\'){ out += '\\'; out += c; }
+        else if(c=='\n') out += "\\n";
+        else if((unsigned char)c < 0x20){ char b[8]; snprintf(b, sizeof(b), "\\u%04x", c); out += b; }
+        else out += c;
+    }
+    out += '"';
+}
+static std::string colorHex(uint32_t rgba){
+    char b[12]; snprintf(b, sizeof(b), "#%02x%02x%02x%02x", rgba & 0xFF, (rgba>>8) & 0xFF, (rgba>>16) & 0xFF, rgba>>24);
+    return b;
+}
+static glm::vec4 parseColorHex(const std::string &s){
+    unsigned v = 0;
+    if(s.size()==9 && s[0]=='#') v = (unsigned)strtoul(s.c_str()+1, nullptr, 16);
+    else if(s.size()==7 && s[0]=='#') v = ((unsigned)strtoul(s.c_str()+1, nullptr, 16) << 8) | 0xFF;
+    else return glm::vec4(1.0f);
+    return glm::vec4(((v>>24)&0xFF)/255.0f, ((v>>16)&0xFF)/255.0f, ((v>>8)&0xFF)/255.0f, (v&0xFF)/255.0f);
+}
+
+// ---------------------- Edit history ----------------------
+// Item geometry as edited: x,y,w,h for rects and doors, x,y,r for circles.
+struct ItemGeom {
+    float v[4] = {0,0,0,0};
+    bool operator==(const ItemGeom &o) const { return !memcmp(v, o.v, sizeof(v)); }
+};
+// Whole item, kept only by add/remove deltas.
+struct ItemRow {
+    RectItem rect{};
+    CircleItem circle{};
+    DoorItem door{};
+};
+// One undoable edit. Moves and resizes store two geometries; only add/remove carry
+// the full row.
+struct EditDelta {
+    enum Kind : uint8_t { GEOMETRY, ADD, REMOVE } kind = GEOMETRY;
+    ItemRef ref;
+    ItemGeom before, after;
+    std::unique_ptr<ItemRow> row;
+};
+// Slot of an item in the static geometry: rect instance / first vertex, or for circles
+// the LOD level in the top byte and the instance / first vertex below it.
+static const int32_t SLOT_NONE = -1;
+static inline int32_t encodeSlot(int lod, size_t index){ return (int32_t)(((uint32_t)lod << 24) | (uint32_t)index); }
+static inline int slotLod(int32_t s){ return (int)((uint32_t)s >> 24); }
+static inline uint32_t slotIndex(int32_t s){ return (uint32_t)s & 0xFFFFFFu; }
+
+// ---------------------- Egress analysis ----------------------
+// Compliance checks over an occupancy grid of the plan: travel distance from every
+// walkable cell to the nearest exit and to the nearest extinguisher (multi-source
+// Dijkstra, 8-connected, no corner cutting), and passages narrower than the minimum
+// corridor width. The engine keeps its own copy of every item's footprint and per-cell
+// coverage counts, so a moved item is un-rasterized and re-rasterized in place and only
+// the cells whose shortest paths ran through the change are recomputed. All of it runs
+// on gWorkers; the GL thread only queues snapshots and edits and reads the report.
+enum EgressRole : uint8_t { ER_NONE, ER_FLOOR, ER_OBSTACLE, ER_DOOR, ER_EXIT, ER_EXTINGUISHER };
+struct EgressShape {
+    ItemBounds b;
+    uint8_t role = ER_NONE;
+    bool circle = false;
+};
+struct EgressSettings {
+    float cell = 10.0f;              // world units (cm) per grid cell
+    float minCorridor = 90.0f;       // clear width below which a passage is reported
+    float maxTravel = 4500.0f;       // allowed travel distance to an exit
+    float extinguisherReach = 2300.0f; // allowed travel distance to an extinguisher
+    bool operator==(const EgressSettings &o) const {
+        return cell==o.cell && minCorridor==o.minCorridor && maxTravel==o.maxTravel && extinguisherReach==o.extinguisherReach;
+    }
+};
+struct EgressReport {
+    bool valid = false;
+    uint64_t revision = 0;             // layoutRevision the report reflects
+    float worstTravel = 0.0f;          // longest walk to an exit, world units
+    ImVec2 worstAt;                    // where it starts
+    size_t walkable = 0, unreachable = 0, tooFar = 0, uncovered = 0, narrow = 0;
+    std::vector<ImVec2> narrowSpots;   // one per cluster of narrow cells, world units
+    int cols = 0, rows = 0;
+    float cell = 0.0f;
+    double ms = 0.0;                   // time of the last update
+    bool incremental = false;
+    size_t repaired = 0;               // cells re-settled by the last update
+};
+
+// Shortest travel cost to a set of source cells, in tenths of a cell (10 straight, 14
+// diagonal). parent[] points one step towards the source, which lets repair() find the
+// cells whose path ran through a changed cell.
+struct DistanceField {
+    static constexpr uint32_t INF = 0xFFFFFFFFu;
+    static constexpr uint8_t NO_PARENT = 8;
+    std::vector<uint32_t> dist;
+    std::vector<uint8_t> parent;
+    int cols = 0, rows = 0;
+    typedef std::pair<uint32_t, uint32_t> Entry; // (dist, cell)
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+    std::vector<uint8_t> mark; // repair() scratch, all zero between calls
+    std::vector<int> touched;  // cells whose distance the last repair() changed (may repeat)
+    bool tracking = false;
+
+    // Directions come in opposite pairs, so k^1 reverses step k.
+    static constexpr int DX[8] = {1, -1, 0, 0, 1, -1, 1, -1};
+    static constexpr int DY[8] = {0, 0, 1, -1, 1, -1, -1, 1};
+    static constexpr uint32_t COST[8] = {10, 10, 10, 10, 14, 14, 14, 14};
+
+    // Neighbour k of cell c, or -1 when off the grid, blocked, or a diagonal that would
+    // squeeze between two blocked cells.
+    int step(const std::vector<uint8_t> &walk, int c, int k) const {
+        int x = c % cols + DX[k], y = c / cols + DY[k];
+        if(x < 0 || y < 0 || x >= cols || y >= rows) return -1;
+        int n = y*cols + x;
+        if(!walk[n]) return -1;
+        if(k >= 4 && (!walk[c + DX[k]] || !walk[c + DY[k]*cols])) return -1;
+        return n;
+    }
+    template<class IsSource> void full(int w, int h, const std::vector<uint8_t> &walk, IsSource isSource){
+        cols = w; rows = h;
+        dist.assign((size_t)w*h, INF);
+        parent.assign((size_t)w*h, NO_PARENT);
+        for(int c=0;c<w*h;c++) if(walk[c] && isSource(c)){ dist[c] = 0; open.push({0, (uint32_t)c}); }
+        settle(walk);
+    }
+    void settle(const std::vector<uint8_t> &walk, size_t *settled = nullptr){
+        while(!open.empty()){
+            Entry e = open.top(); open.pop();
+            int c = (int)e.second;
+            if(e.first != dist[c]) continue; // stale
+            if(settled) (*settled)++;
+            for(int k=0;k<8;k++){
+                int n = step(walk, c, k);
+                if(n < 0) continue;
+                uint32_t d = e.first + COST[k];
+                if(d < dist[n]){
+                    dist[n] = d; parent[n] = (uint8_t)(k ^ 1); open.push({d, (uint32_t)n});
+                    if(tracking) touched.push_back(n);
+                }
+            }
+        }
+    }
+    // Re-settles after the cells in `changed` flipped walkability or source status:
+    // drops every cell whose path led through (or squeezed diagonally past) one of them,
+    // then grows again from the intact frontier. Distances that shrink spread out through
+    // the same relaxation, so both moves towards and away from a path are handled.
+    template<class IsSource> size_t repair(const std::vector<int> &changed, const std::vector<uint8_t> &walk, IsSource isSource){
+        if(mark.size() != dist.size()) mark.assign(dist.size(), 0);
+        std::vector<int> stack(changed.begin(), changed.end()), dropped;
+        touched.clear();
+        for(int c: changed){ // diagonal steps that cut past a changed corner
+            int x = c % cols, y = c / cols;
+            for(int k=0;k<8;k++){
+                int nx = x + DX[k], ny = y + DY[k];
+                if(nx < 0 || ny < 0 || nx >= cols || ny >= rows) continue;
+                int n = ny*cols + nx;
+                uint8_t p = parent[n];
+                if(p >= 4 && p != NO_PARENT && (n + DX[p] == c || n + DY[p]*cols == c)) stack.push_back(n);
+            }
+        }
+        while(!stack.empty()){
+            int c = stack.back(); stack.pop_back();
+            if(mark[c]) continue;
+            mark[c] = 1;
+            dropped.push_back(c);
+            int x = c % cols, y = c / cols;
+            for(int k=0;k<8;k++){ // children: neighbours whose parent step lands on c
+                int nx = x + DX[k], ny = y + DY[k];
+                if(nx < 0 || ny < 0 || nx >= cols || ny >= rows) continue;
+                int n = ny*cols + nx;
+                if(parent[n] == (uint8_t)(k ^ 1) && !mark[n]) stack.push_back(n);
+            }
+        }
+        for(int c: dropped){ dist[c] = INF; parent[c] = NO_PARENT; }
+        for(int c: dropped){
+            mark[c] = 0;
+            if(!walk[c]) continue;
+            if(isSource(c)){ dist[c] = 0; open.push({0, (uint32_t)c}); continue; }
+            for(int k=0;k<8;k++){ // best intact neighbour
+                int n = step(walk, c, k);
+                if(n < 0 || dist[n] == INF) continue;
+                uint32_t d = dist[n] + COST[k];
+                if(d < dist[c]){ dist[c] = d; parent[c] = (uint8_t)k; }
+            }
+            if(dist[c] != INF) open.push({dist[c], (uint32_t)c});
+        }
+        for(int c: changed){ // a cell opening up also unblocks diagonals between its neighbours
+            int x = c % cols, y = c / cols;
+            for(int k=0;k<8;k++){
+                int nx = x + DX[k], ny = y + DY[k];
+                if(nx < 0 || ny < 0 || nx >= cols || ny >= rows) continue;
+                int n = ny*cols + nx;
+                if(dist[n] != INF) open.push({dist[n], (uint32_t)n});
+            }
+        }
+        touched.insert(touched.end(), dropped.begin(), dropped.end());
+        size_t settled = 0;
+        tracking = true;
+        settle(walk, &settled);
+        tracking = false;
+        return dropped.size() + settled;
+    }
+};
+
+struct EgressEngine : std::enable_shared_from_this<EgressEngine> {
+    struct Job {
+        bool full = false;
+        EgressSettings settings;
+        ItemBounds area;                         // full: grid extent
+        std::vector<EgressShape> shapes[CAT_COUNT]; // full: every item
+        ItemRef ref; EgressShape shape;          // move: the item's new footprint
+        uint64_t revision = 0;
+    };
+    // Worker state
+    EgressSettings settings;
+    ItemBounds area;
+    float cell = 10.0f;
+    int cols = 0, rows = 0;
+    std::vector<EgressShape> shapes[CAT_COUNT];
+    std::vector<uint16_t> floorN, obstacleN, doorN, exitN, extN;
+    std::vector<uint8_t> walk, narrow;
+    DistanceField travel, reach;
+    // Running summary: what each cell contributes to the report and the totals of those
+    // bits, so an edit only recounts the cells it re-settled or re-checked.
+    enum : uint8_t { F_WALK = 1, F_UNREACHABLE = 2, F_TOO_FAR = 4, F_UNCOVERED = 8, F_NARROW = 16, F_BITS = 5 };
+    static const int BLOCK = 8; // narrow cells are reported once per BLOCK x BLOCK cells
+    std::vector<uint8_t> flags;
+    size_t totals[F_BITS] = {};
+    std::vector<uint32_t> blockNarrow;
+    int blockCols = 0;
+    uint32_t worst = 0;  // longest finite travel, tenths of a cell
+    int worstCell = -1;  // lowest-numbered cell at that distance
+    // Shared with the GL thread
+    std::mutex m;
+    std::deque<Job> queue;
+    bool running = false;
+    EgressReport report;
+
+    void submit(Job &&job){
+        {
+            std::lock_guard<std::mutex> lock(m);
+            if(job.full) queue.clear(); // a snapshot supersedes everything queued
+            queue.push_back(std::move(job));
+            if(running) return;
+            running = true;
+        }
+        std::shared_ptr<EgressEngine> self = shared_from_this();
+        gWorkers.submit([self]{ self->drain(); });
+    }
+    EgressReport latest(){ std::lock_guard<std::mutex> lock(m); return report; }
+    bool busy(){ std::lock_guard<std::mutex> lock(m); return running; }
+
+    void drain(){
+        for(;;){
+            Job job;
+            {
+                std::lock_guard<std::mutex> lock(m);
+                if(queue.empty()){ running = false; return; }
+                job = std::move(queue.front()); queue.pop_front();
+            }
+            auto start = std::chrono::steady_clock::now();
+            size_t repaired = job.full ? rebuild(job) : move(job);
+            EgressReport r = summarize();
+            r.revision = job.revision;
+            r.incremental = !job.full;
+            r.repaired = repaired;
+            r.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            { std::lock_guard<std::mutex> lock(m); report = std::move(r); }
+            gRedraw.request();
+        }
+    }
+
+    // Cells a shape covers: obstacles any overlap (thin walls must block), floors by cell
+    // centre, doors across the wall they sit in, extinguishers one cell around.
+    template<class F> void cellsOf(const EgressShape &s, F &&fn) const {
+        ItemBounds b = s.b;
+        if(s.role==ER_DOOR || s.role==ER_EXIT){
+            if(b.x1 - b.x0 < b.y1 - b.y0){ b.x0 -= cell; b.x1 += cell; } else { b.y0 -= cell; b.y1 += cell; }
+        }
+        if(s.role==ER_EXTINGUISHER) b = b.expanded(cell);
+        const bool byCentre = s.role==ER_FLOOR;
+        float ox = area.x0, oy = area.y0;
+        // Shapes off the grid give an empty range rather than clamping onto the edge.
+        int cx0 = floorToCell((b.x0 - ox)/cell, 0, cols), cx1 = floorToCell((b.x1 - ox)/cell, -1, cols-1);
+        int cy0 = floorToCell((b.y0 - oy)/cell, 0, rows), cy1 = floorToCell((b.y1 - oy)/cell, -1, rows-1);
+        float r = (b.x1 - b.x0)*0.5f, ccx = (b.x0 + b.x1)*0.5f, ccy = (b.y0 + b.y1)*0.5f;
+        for(int y=cy0;y<=cy1;y++) for(int x=cx0;x<=cx1;x++){
+            float x0 = ox + x*cell, y0 = oy + y*cell;
+            if(byCentre && !b.contains(x0 + cell*0.5f, y0 + cell*0.5f)) continue;
+            if(s.circle){ // nearest point of the cell to the centre
+                float nx = std::max(x0, std::min(ccx, x0 + cell)) - ccx, ny = std::max(y0, std::min(ccy, y0 + cell)) - ccy;
+                if(nx*nx + ny*ny > r*r) continue;
+            }
+            fn(y*cols + x);
+        }
+    }
+    std::vector<uint16_t> *countsFor(uint8_t role){
+        switch(role){
+        case ER_FLOOR: return &floorN;
+        case ER_OBSTACLE: return &obstacleN;
+        case ER_DOOR: return &doorN;
+        case ER_EXIT: return &exitN;
+        case ER_EXTINGUISHER: return &extN;
+        default: return nullptr;
+        }
+    }
+    void rasterize(const EgressShape &s, int delta, int *bx0 = nullptr, int *by0 = nullptr, int *bx1 = nullptr, int *by1 = nullptr){
+        std::vector<uint16_t> *counts = countsFor(s.role);
+        if(!counts) return;
+        cellsOf(s, [&](int c){
+            (*counts)[c] = (uint16_t)((*counts)[c] + delta);
+            if(s.role==ER_EXIT) doorN[c] = (uint16_t)(doorN[c] + delta); // exits carve like doors
+            if(bx0){ int x = c % cols, y = c / cols; *bx0 = std::min(*bx0, x); *by0 = std::min(*by0, y); *bx1 = std::max(*bx1, x); *by1 = std::max(*by1, y); }
+        });
+    }
+    bool walkable(int c) const { return floorN[c] > 0 && (obstacleN[c]==0 || doorN[c] > 0); }
+    bool isExit(int c) const { return exitN[c] > 0; }
+    bool isExtinguisher(int c) const { return extN[c] > 0; }
+
+    size_t rebuild(Job &job){
+        settings = job.settings;
+        area = job.area;
+        // Keep the grid to about 2M cells on big venues.
+        float w = area.x1 - area.x0, h = area.y1 - area.y0;
+        cell = std::max(settings.cell, sqrtf(w*h / 2.0e6f));
+        cols = std::max(1, (int)ceilf(w / cell)); rows = std::max(1, (int)ceilf(h / cell));
+        size_t n = (size_t)cols*rows;
+        for(auto *v: {&floorN, &obstacleN, &doorN, &exitN, &extN}) v->assign(n, 0);
+        for(uint8_t c=0;c<CAT_COUNT;c++){
+            shapes[c] = std::move(job.shapes[c]);
+            for(auto &s: shapes[c]) rasterize(s, 1);
+        }
+        walk.resize(n);
+        for(size_t c=0;c<n;c++) walk[c] = walkable((int)c);
+        travel.full(cols, rows, walk, [&](int c){ return isExit(c); });
+        reach.full(cols, rows, walk, [&](int c){ return isExtinguisher(c); });
+        narrow.assign(n, 0);
+        updateNarrow(0, 0, cols-1, rows-1);
+        flags.assign(n, 0);
+        for(auto &t: totals) t = 0;
+        blockCols = (cols+BLOCK-1)/BLOCK;
+        blockNarrow.assign((size_t)blockCols*((rows+BLOCK-1)/BLOCK), 0);
+        worst = 0; worstCell = -1;
+        for(size_t c=0;c<n;c++) recount((int)c);
+        return n;
+    }
+    size_t move(Job &job){
+        if(!cols || job.ref.cat >= CAT_COUNT || job.ref.index >= shapes[job.ref.cat].size()) return 0;
+        EgressShape &old = shapes[job.ref.cat][job.ref.index];
+        int x0 = cols, y0 = rows, x1 = -1, y1 = -1;
+        rasterize(old, -1, &x0, &y0, &x1, &y1);
+        old = job.shape;
+        rasterize(old, 1, &x0, &y0, &x1, &y1);
+        if(x1 < 0) return 0; // off the grid both before and after
+        std::vector<int> changedWalk, changedExit, changedExt;
+        for(int y=y0;y<=y1;y++) for(int x=x0;x<=x1;x++){
+            int c = y*cols + x;
+            uint8_t nw = walkable(c);
+            bool wasExit = travel.dist[c]==0, wasExt = reach.dist[c]==0;
+            if(nw != walk[c]){ walk[c] = nw; changedWalk.push_back(c); }
+            if(nw && isExit(c) != wasExit) changedExit.push_back(c);
+            if(nw && isExtinguisher(c) != wasExt) changedExt.push_back(c);
+        }
+        size_t repaired = 0;
+        std::vector<int> t = changedWalk; t.insert(t.end(), changedExit.begin(), changedExit.end());
+        if(!t.empty()) repaired += travel.repair(t, walk, [&](int c){ return isExit(c); });
+        std::vector<int> e = changedWalk; e.insert(e.end(), changedExt.begin(), changedExt.end());
+        if(!e.empty()) repaired += reach.repair(e, walk, [&](int c){ return isExtinguisher(c); });
+        int span = (int)ceilf(settings.minCorridor / cell) + 1; // a ray that could cross the change
+        x0 = std::max(0, x0 - span); y0 = std::max(0, y0 - span); x1 = std::min(cols-1, x1 + span); y1 = std::min(rows-1, y1 + span);
+        updateNarrow(x0, y0, x1, y1);
+        bool worstLost = false;
+        for(int y=y0;y<=y1;y++) for(int x=x0;x<=x1;x++) worstLost |= recount(y*cols + x);
+        for(int c: travel.touched) worstLost |= recount(c);
+        for(int c: reach.touched) worstLost |= recount(c);
+        travel.touched.clear(); reach.touched.clear();
+        if(worstLost){ // the farthest cell got closer: only a scan finds the new farthest
+            worst = 0; worstCell = -1;
+            for(int c=0;c<cols*rows;c++) noteTravel(c);
+        }
+        return repaired;
+    }
+    uint8_t cellFlags(int c) const {
+        if(!walk[c]) return 0;
+        uint8_t f = F_WALK;
+        const float toWorld = cell / 10.0f;
+        uint32_t d = travel.dist[c];
+        if(d == DistanceField::INF) f |= F_UNREACHABLE;
+        else if(d*toWorld > settings.maxTravel) f |= F_TOO_FAR;
+        if(reach.dist[c] == DistanceField::INF || reach.dist[c]*toWorld > settings.extinguisherReach) f |= F_UNCOVERED;
+        if(narrow[c]) f |= F_NARROW;
+        return f;
+    }
+    // Travel of cell c if it is walkable and reachable, else 0.
+    uint32_t travelOf(int c) const { return walk[c] && travel.dist[c] != DistanceField::INF ? travel.dist[c] : 0; }
+    void noteTravel(int c){
+        uint32_t d = travelOf(c);
+        if(d > worst || (d == worst && d > 0 && c < worstCell)){ worst = d; worstCell = c; }
+    }
+    // Moves cell c's contribution to its current state; true when c was the farthest
+    // cell and no longer is.
+    bool recount(int c){
+        uint8_t f = cellFlags(c), o = flags[c];
+        if(f != o){
+            for(int b=0;b<F_BITS;b++){
+                if(!((f ^ o) >> b & 1)) continue;
+                if(f >> b & 1) totals[b]++; else totals[b]--;
+            }
+            if((f ^ o) & F_NARROW){
+                uint32_t &n = blockNarrow[(size_t)(c / cols / BLOCK)*blockCols + (c % cols)/BLOCK];
+                if(f & F_NARROW) n++; else n--;
+            }
+            flags[c] = f;
+        }
+        if(c == worstCell && travelOf(c) < worst) return true;
+        noteTravel(c);
+        return false;
+    }
+    // A cell is in a narrow passage when the free run through it, across or along, is
+    // shorter than minCorridor and walled at both ends. Diagonals are left out: they
+    // would flag every room corner. Door openings are meant to be narrow and are skipped.
+    void updateNarrow(int x0, int y0, int x1, int y1){
+        x0 = std::max(0, x0); y0 = std::max(0, y0); x1 = std::min(cols-1, x1); y1 = std::min(rows-1, y1);
+        const int limit = (int)(settings.minCorridor / cell);
+        for(int y=y0;y<=y1;y++) for(int x=x0;x<=x1;x++){
+            int c = y*cols + x;
+            narrow[c] = 0;
+            if(!walk[c] || doorN[c]) continue;
+            for(int axis=0; axis<2 && !narrow[c]; axis++){
+                int run = 1;
+                bool walled = true;
+                for(int dir=-1; dir<=1 && walled; dir+=2){
+                    int k = 1;
+                    for(; run <= limit; k++, run++){
+                        int nx = axis ? x : x + dir*k, ny = axis ? y + dir*k : y;
+                        if(nx < 0 || ny < 0 || nx >= cols || ny >= rows || !walk[ny*cols + nx]) break;
+                    }
+                    if(run > limit) walled = false;
+                }
+                if(walled && run*cell < settings.minCorridor) narrow[c] = 1;
+            }
+        }
+    }
+    // Reads the running totals; only the block table (1/64 of the grid) is walked to
+    // place the narrow-passage markers.
+    EgressReport summarize() const {
+        EgressReport r;
+        r.valid = true; r.cols = cols; r.rows = rows; r.cell = cell;
+        r.walkable = totals[0]; r.unreachable = totals[1]; r.tooFar = totals[2]; r.uncovered = totals[3]; r.narrow = totals[4];
+        for(size_t b=0;b<blockNarrow.size() && r.narrowSpots.size() < 512;b++){
+            if(!blockNarrow[b]) continue;
+            int bx = (int)(b % blockCols)*BLOCK, by = (int)(b / blockCols)*BLOCK;
+            bool found = false;
+            for(int y=by;y<std::min(rows, by+BLOCK) && !found;y++)
+                for(int x=bx;x<std::min(cols, bx+BLOCK) && !found;x++)
+                    if(narrow[y*cols + x]){ r.narrowSpots.push_back(cellCentre(y*cols + x)); found = true; }
+        }
+        r.worstTravel = worst * (cell / 10.0f);
+        if(worstCell >= 0) r.worstAt = cellCentre(worstCell);
+        return r;
+    }
+    ImVec2 cellCentre(int c) const { return ImVec2(area.x0 + (c % cols + 0.5f)*cell, area.y0 + (c / cols + 0.5f)*cell); }
+};
+
+// ---------------------- Seating index ----------------------
+// tablesRect mixes tables, chairs and sofa parts that differ only by label and size, so
+// every item is typed once when it changes and each seat is linked to the nearest table
+// within SEAT_REACH. Running totals per zone (floor area), table kind and floor are
+// adjusted as items move, so reading them costs nothing however often the panel polls.
+enum TableKind : uint8_t { TK_RECT, TK_ROUND, TK_SOFA, TK_COUNT };
+static const char *const TABLE_KIND_NAMES[TK_COUNT] = {"Rectangular", "Round", "Sofa"};
+struct SeatTotals {
+    uint32_t tables = 0, seats = 0;
+    uint32_t loose = 0; // seats not at any table (bar stools, stray chairs)
+};
+struct SeatIndex {
+    static constexpr float SEAT_REACH = 20.0f; // seat centre to table edge
+    enum Role : uint8_t { ROLE_NONE, ROLE_TABLE, ROLE_SEAT };
+    struct Entry {
+        uint8_t role = ROLE_NONE;
+        uint8_t kind = TK_RECT;        // tables
+        uint32_t zone = 0;             // floor item holding the centre; zoneNames.size()-1 outside all
+        ItemRef parent;                // seats: their table
+        std::vector<ItemRef> children; // tables: their seats
+        bool counted = false;          // contribution is in the totals
+    };
+    std::vector<Entry> entries[2]; // tablesRect, tablesCircle
+    SeatTotals total;
+    SeatTotals byKind[TK_COUNT];
+    std::vector<SeatTotals> byZone;
+    std::vector<std::string> zoneNames;
+
+    Entry &at(ItemRef r){ return entries[r.cat==CAT_TABLE_CIRCLE][r.index]; }
+    void clear(size_t rects, size_t circles, size_t zones){
+        entries[0].assign(rects, Entry());
+        entries[1].assign(circles, Entry());
+        total = SeatTotals();
+        for(auto &k: byKind) k = SeatTotals();
+        byZone.assign(zones, SeatTotals());
+    }
+    // Adds (sign 1) or removes (sign -1) an item's share of the totals. A seat counts
+    // towards its table's zone and kind.
+    void count(ItemRef r, int sign){
+        Entry &e = at(r);
+        if(e.role==ROLE_NONE || e.counted == (sign > 0)) return;
+        e.counted = sign > 0;
+        if(e.role==ROLE_TABLE){
+            total.tables += sign; byKind[e.kind].tables += sign; byZone[e.zone].tables += sign;
+        } else if(e.parent.valid()){
+            const Entry &t = at(e.parent);
+            total.seats += sign; byKind[t.kind].seats += sign; byZone[t.zone].seats += sign;
+        } else {
+            total.seats += sign; total.loose += sign;
+            byZone[e.zone].seats += sign; byZone[e.zone].loose += sign;
+        }
+    }
+    void unlink(ItemRef seat){
+        Entry &e = at(seat);
+        count(seat, -1);
+        if(!e.parent.valid()) return;
+        auto &kids = at(e.parent).children;
+        for(size_t k=0;k<kids.size();k++) if(kids[k]==seat){ kids[k] = kids.back(); kids.pop_back(); break; }
+        e.parent = ItemRef();
+    }
+    void link(ItemRef seat, ItemRef table){
+        Entry &e = at(seat);
+        e.parent = table;
+        if(table.valid()) at(table).children.push_back(seat);
+        count(seat, 1);
+    }
+};
+
+// ---------------------- Elevation Parameters ----------------------
+static const float wallHeight   = 300.0f;  // cm or arbitrary units
+static const float doorHeight   = 220.0f;
+static const float windowHeight = 120.0f;
+static const float windowSill   = 90.0f;
+
+// ---------------------- Elevation views ----------------------
+// A side-on projection of walls, windows and doors, drawn once through the flat shader
+// into a texture and shown as a single textured quad. The texture is redrawn only when
+// the plan's layoutRevision moves; panning and zooming just move the quad's UVs.
+// Elevation space: u runs along the view, v is height above the ground.
+struct ElevationView {
+    static const int MAX_TEXTURE = 2048; // longest texture side, in texels
+    static constexpr float kMaxZoom = 8.0f;
+    struct Face { float u, v, w, h; uint32_t rgba; float depth; uint8_t rank; };
+
+    std::vector<Face> faces;  // painter's order after render(): far to near
+    GLuint fbo=0, tex=0;
+    int texW=0, texH=0;
+    ItemBounds extent{0.0f, 0.0f, 1200.0f, wallHeight};
+    DrawBuffer quads;         // fills and their outlines, interleaved in depth order
+    std::vector<float> eu, ev, ew, eh;
+    std::vector<uint32_t> ergba, eidx;
+    uint64_t builtRevision = UINT64_MAX;
+    uint8_t builtShown = 0;   // showWindows | showDoors<<1 at the last build
+    float zoom = 1.0f, centerU = 0.5f, centerV = 0.5f; // view, in texture coordinates
+
+    void begin(){ faces.clear(); }
+    // depth: distance from the viewer; rank breaks ties so openings land on their wall.
+    void add(float u, float v, float w, float h, uint32_t rgba, float depth, uint8_t rank){
+        faces.push_back({u, v, w, h, rgba, depth, rank});
+    }
+    void emit(float u, float v, float w, float h, uint32_t rgba){
+        eidx.push_back((uint32_t)eu.size());
+        eu.push_back(u); ev.push_back(v); ew.push_back(w); eh.push_back(h); ergba.push_back(rgba);
+    }
+
+    void render(SceneShaders &sh){
+        std::stable_sort(faces.begin(), faces.end(), [](const Face &a, const Face &b){
+            return a.depth != b.depth ? a.depth > b.depth : a.rank < b.rank;
+        });
+        ItemBounds e{0.0f, 0.0f, 1.0f, wallHeight};
+        if(!faces.empty()) e = {FLT_MAX, 0.0f, -FLT_MAX, wallHeight};
+        for(auto &f: faces){ e.x0 = std::min(e.x0, f.u); e.x1 = std::max(e.x1, f.u+f.w); e.y1 = std::max(e.y1, f.v+f.h); }
+        extent = e.expanded(20.0f);
+        float extW = extent.x1-extent.x0, extH = extent.y1-extent.y0;
+        float texelsPerUnit = MAX_TEXTURE / std::max(extW, extH);
+        int w = std::max(1, (int)ceilf(extW*texelsPerUnit)), h = std::max(1, (int)ceilf(extH*texelsPerUnit));
+        allocate(w, h);
+
+        // Outlines are one-texel quads emitted right after their fill, so painter's order
+        // holds for them too and the whole view is one triangle draw.
+        const float t = 1.0f / texelsPerUnit;
+        const uint32_t black = packColor(0.0f, 0.0f, 0.0f, 1.0f);
+        eu.clear(); ev.clear(); ew.clear(); eh.clear(); ergba.clear(); eidx.clear();
+        emit(extent.x0, -t, extW, 2.0f*t, black); // ground line
+        for(auto &f: faces){
+            emit(f.u, f.v, f.w, f.h, f.rgba | 0xFF000000u);
+            emit(f.u, f.v, f.w, t, black);         emit(f.u, f.v+f.h-t, f.w, t, black);
+            emit(f.u, f.v, t, f.h, black);         emit(f.u+f.w-t, f.v, t, f.h, black);
+        }
+        quads.begin();
+        addRects(quads, RectSpan{eu.data(), ev.data(), ew.data(), eh.data(), ergba.data()}, eidx, RECT_FILL);
+        quads.upload();
+
+        GLint prevFbo = 0, prevViewport[4];
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFbo);
+        glGetIntegerv(GL_VIEWPORT, prevViewport);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glViewport(0, 0, texW, texH);
+        glClearColor(0.96f, 0.96f, 0.96f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        sh.flat.use();
+        sh.flat.setMat4(sh.flatMVP, glm::ortho(extent.x0, extent.x1, extent.y0, extent.y1, -1.0f, 1.0f));
+        sh.flat.setInt(sh.flatUseTexture, false);
+        quads.draw(GL_TRIANGLES);
+        glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)prevFbo);
+        glViewport(prevViewport[0], prevViewport[1], prevViewport[2], prevViewport[3]);
+        gGLState.bindTexture(GL_TEXTURE_2D, tex);
+        glGenerateMipmap(GL_TEXTURE_2D); // zoomed-out windows minify a lot
+    }
+    void allocate(int w, int h){
+        if(!fbo) glGenFramebuffers(1, &fbo);
+        if(tex && w==texW && h==texH) return;
+        if(!tex) glGenTextures(1, &tex);
+        texW = w; texH = h;
+        gGLState.bindTexture(GL_TEXTURE_2D, tex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        const float border[4] = {0.96f, 0.96f, 0.96f, 1.0f}; // the clear colour past the edges
+        glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
+        if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) std::cerr<<"Elevation: framebuffer incomplete\n";
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if(!quads.vao) quads.init();
+    }
+
+    // The texture fills the window's content region: wheel zooms about the cursor, a left
+    // drag pans, a double click resets. Only the quad's UVs change.
+    void show(){
+        ImGuiIO &io = ImGui::GetIO();
+        ImVec2 avail = ImGui::GetContentRegionAvail();
+        avail.x = std::max(avail.x, 64.0f); avail.y = std::max(avail.y, 64.0f);
+        ImVec2 p0 = ImGui::GetCursorScreenPos();
+        ImGui::InvisibleButton("elevation", avail);
+        // Square texels on screen: the visible v range follows the window's aspect.
+        const float aspect = (avail.y/avail.x) * ((float)texW/std::max(texH, 1));
+        float spanU = 1.0f/zoom, spanV = spanU*aspect;
+        if(ImGui::IsItemHovered()){
+            float mx = (io.MousePos.x-p0.x)/avail.x - 0.5f, my = (io.MousePos.y-p0.y)/avail.y - 0.5f;
+            if(io.MouseWheel != 0.0f){
+                float su = centerU + mx*spanU, sv = centerV - my*spanV; // texel under the cursor
+                zoom = glm::clamp(zoom * powf(1.15f, io.MouseWheel), 1.0f, kMaxZoom);
+                spanU = 1.0f/zoom; spanV = spanU*aspect;
+                centerU = su - mx*spanU; centerV = sv + my*spanV;
+            }
+            if(ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left)){
+                zoom = 1.0f; centerU = centerV = 0.5f;
+                spanU = 1.0f; spanV = aspect;
+            }
+        }
+        if(ImGui::IsItemActive()){
+            centerU -= io.MouseDelta.x/avail.x*spanU;
+            centerV += io.MouseDelta.y/avail.y*spanV;
+        }
+        centerU = glm::clamp(centerU, 0.0f, 1.0f);
+        centerV = glm::clamp(centerV, 0.0f, 1.0f);
+        ImGui::GetWindowDrawList()->AddImage((ImTextureID)(intptr_t)tex, p0, ImVec2(p0.x+avail.x, p0.y+avail.y),
+            ImVec2(centerU - spanU*0.5f, centerV + spanV*0.5f), ImVec2(centerU + spanU*0.5f, centerV - spanV*0.5f));
+    }
+    size_t gpuBytes() const { return (size_t)texW*texH*4*4/3 + quads.gpuBytes(); }
+    void destroy(){
+        if(tex) glDeleteTextures(1, &tex);
+        if(fbo) glDeleteFramebuffers(1, &fbo);
+        if(quads.vao) quads.destroy();
+        tex = fbo = 0; texW = texH = 0;
+        builtRevision = UINT64_MAX;
+    }
+};
+
+struct FloorPlan {
+    bool showGrid = true;
+    bool showLabels = true;
+    bool showDoorSwings = true;
+    bool showDimensions = true;
+    bool showDrains=true;
+    bool showScaleBar=true;
+    float scaleX = 1.0f;
+    float scaleY = 1.0f;
+    bool showWindows = true;
+    bool showDoors = true;
+    bool showFrontElevation=false;
+    bool showSideElevation=true;
+    ElevationView frontElevation, sideElevation;
+    // Bumped by every layout or item change; cached views (elevations) compare against it.
+    uint64_t layoutRevision = 0;
+    // Labels of every category are interned here; the stores below point at it.
+    StringTable strings;
+    RectStore walls{&strings};
+    RectStore kitchen{&strings};
+    RectStore bar{&strings};
+    RectStore windows{&strings};
+    RectStore restrooms{&strings};
+    RectStore fire{&strings};
+    RectStore tablesRect{&strings};
+    CircleStore tablesCircle{&strings};
+    DoorStore doors{&strings};
+    RectStore floor{&strings};
+    CircleStore drains{&strings};
+    DrawBuffer triBuf;
+    DrawBuffer lineBuf;
+    // Instanced path: rects and circles as one instance each over shared unit meshes.
+    bool useInstancing = true;
+    bool builtInstanced = false;
+    UnitMeshes unitMeshes;
+    InstanceBuffer rectInst;
+    InstanceBuffer circleInst[CIRCLE_LOD_COUNT]; // one per circle LOD level
+    // Analytic path (instanced only): circles, outlines, door swings and the grid are
+    // unit quads shaded by SDF_FRAG_SRC. Circles then all sit in circleInst[0], an
+    // outline's line slot indexes outlineInst and a door's line slot its swing.
+    bool useAnalyticShapes = true;
+    bool builtAnalytic = false;
+    InstanceBuffer outlineInst, swingInst, gridInst;
+    float builtLodScale = 0.0f; // on-screen scale the circle LODs were picked for
+    // Static geometry lives in triBuf/lineBuf and is only rebuilt when this is set.
+    bool geometryDirty = true;
+    size_t gridVertexCount = 0; // grid lines sit at the start of lineBuf
+    glm::mat4 proj;
+    int canvasW=1200, canvasH=800;
+    OverlayPass overlay;
+    MappedFile layoutFile; // backing store of borrowed item columns after loadLayout()
+    SpatialGrid index;
+    std::vector<uint32_t> visibleItems[CAT_COUNT]; // per category, filled by cullToView()
+    // Egress and clearance checks, computed on gWorkers; the engine is shared with its
+    // jobs so a plan evicted mid-run doesn't pull the grid out from under them.
+    bool analyseEgress = false;
+    EgressSettings egressSettings;
+    ItemBounds egressArea; // grid extent of the last full submission
+    std::shared_ptr<EgressEngine> egress = std::make_shared<EgressEngine>();
+    SeatIndex seating; // typed tables and seats with live capacity totals
+    Camera camera;
+    // Static geometry covers builtRegion (the view plus slack), not the whole plan;
+    // panning inside it reuses the buffers.
+    ItemBounds builtRegion;
+    std::vector<uint32_t> builtItems[CAT_COUNT];
+    bool builtFineDetail = true;
+    // Where each built item landed, so edits can patch it in place (see patchItemGeometry).
+    std::vector<int32_t> fillSlot[CAT_COUNT], lineSlot[CAT_COUNT];
+    // While pinned (a tiled export is running) static geometry covers pinnedRegion at
+    // pinnedScale's detail, so export tiles and the live frames between them share one
+    // build instead of each rebuilding for its own view.
+    bool geometryPinned = false;
+    ItemBounds pinnedRegion;
+    float pinnedScale = 1.0f;
+    // One slice of a category's built items, tessellated by a single job into its own
+    // buffers and then copied to its base in the shared ones (see buildStaticGeometry).
+    struct GeometryChunk {
+        uint8_t cat = 0;
+        uint32_t first = 0, count = 0; // builtItems[cat][first, first+count)
+        DrawBuffer tri, line;
+        InstanceBuffer rects, circles[CIRCLE_LOD_COUNT], outlines, swings;
+        std::vector<uint32_t> shown;
+        size_t triBase = 0, lineBase = 0, rectBase = 0, circleBase[CIRCLE_LOD_COUNT] = {}, outlineBase = 0, swingBase = 0;
+    };
+    static constexpr uint32_t GEOMETRY_CHUNK_ITEMS = 2048;
+    std::vector<GeometryChunk> geometryChunks; // kept so rebuilds reuse their storage
+    // Editing
+    bool editMode = false;
+    ItemRef selected;
+    std::vector<EditDelta> undoStack, redoStack;
+    enum DragMode { DRAG_NONE, DRAG_MOVE, DRAG_RESIZE } dragMode = DRAG_NONE;
+    ItemGeom dragStart;
+    glm::vec2 dragAnchor;
+   
+    bool frontView = false;
+    float doorHeight = 210.0f;
+    float windowHeight = 120.0f;
+
+ 
+   void init(int w,int h){
+        setupDefaultLayout();
+        initGL(w,h);
+    }
+    // Creates the GL objects only; the layout may already have been loaded off-thread.
+    void initGL(int w,int h){
+        canvasW=w; canvasH=h;
+        triBuf.init(); lineBuf.init();
+        unitMeshes.init();
+        rectInst.init(unitMeshes, unitMeshes.quadFirst, unitMeshes.quadCount, false);
+        for(int l=0;l<CIRCLE_LOD_COUNT;l++)
+            circleInst[l].init(unitMeshes, unitMeshes.circleFirst[l], unitMeshes.circleCount[l], true);
+        outlineInst.init(unitMeshes, unitMeshes.quadFirst, unitMeshes.quadCount, false);
+        swingInst.init(unitMeshes, unitMeshes.quadFirst, unitMeshes.quadCount, true);
+        gridInst.init(unitMeshes, unitMeshes.quadFirst, unitMeshes.quadCount, false);
+        updateProjection(w,h);
+    }
+    // Rough CPU + GPU footprint, used by SceneManager's eviction budget.
+    size_t memoryBytes(){
+        size_t bytes = sizeof(FloorPlan);
+        for(uint8_t c=0;c<CAT_COUNT;c++) visitColumns(c, [&](auto &col, bool){ if(!col.borrowed()) bytes += col.size()*4; });
+        for(auto &str: strings.strings) bytes += str.size() + sizeof(std::string);
+        bytes += triBuf.gpuBytes() + lineBuf.gpuBytes() + triBuf.data.capacity()*sizeof(PackedVertex) + lineBuf.data.capacity()*sizeof(PackedVertex);
+        bytes += rectInst.capacity*sizeof(ShapeInstance);
+        for(auto &ci: circleInst) bytes += ci.capacity*sizeof(ShapeInstance);
+        bytes += (outlineInst.capacity + swingInst.capacity)*sizeof(ShapeInstance);
+        bytes += frontElevation.gpuBytes() + sideElevation.gpuBytes();
+        return bytes + layoutFile.size;
+    }
+    // Rows for the profiler window: resident size of every scene buffer.
+    void drawBufferStats() {
+        ImGui::Text("triBuf: %zu vertices (%.1f KB GPU)", triBuf.vertexCount, triBuf.gpuBytes()/1024.0);
+        ImGui::Text("lineBuf: %zu vertices (%.1f KB GPU)", lineBuf.vertexCount, lineBuf.gpuBytes()/1024.0);
+        size_t circles = 0;
+        for(auto &b: circleInst) circles += b.data.size();
+        ImGui::Text("Instances: %zu rects, %zu circles", rectInst.data.size(), circles);
+        if(builtAnalytic) ImGui::Text("Analytic: %zu outlines, %zu door swings", outlineInst.data.size(), swingInst.data.size());
+    }
+    void markGeometryDirty(){ geometryDirty = true; }
+    void pinGeometry(const ItemBounds &region, float scale){
+        geometryPinned = true; pinnedRegion = region; pinnedScale = scale;
+        markGeometryDirty();
+    }
+    void unpinGeometry(){
+        if(!geometryPinned) return;
+        geometryPinned = false;
+        markGeometryDirty();
+    }
+    void setupEmptyLayout(){
+        markGeometryDirty();
+        floor.clear(); walls.clear(); kitchen.clear(); bar.clear(); windows.clear(); restrooms.clear();
+        fire.clear(); tablesRect.clear(); tablesCircle.clear(); doors.clear();drains.clear();
+        strings.clear();
+        layoutFile.close(); // nothing borrows from it any more
+        resetEditState();
+        layoutRevision++;
+    }
+    void setupDefaultLayout(){
+        setupEmptyLayout();
+
+        floor.push_back({50, 50, 1100, 700, glm::vec4(0.172f, 0.243f, 0.314f, 1.0f), "Floor"});
+        // --- Exterior wall ---
+        walls.push_back({50,50,15,700, glm::vec4(0.172f,0.243f,0.314f,1.0f), "Exterior Wall"});
+        walls.push_back({50,50,1100,15, glm::vec4(0.172f,0.243f,0.314f,1.0f), "Exterior Wall"});
+        walls.push_back({1135,50,15,700, glm::vec4(0.172f,0.243f,0.314f,1.0f), "Exterior Wall"});
+        walls.push_back({50,750,1100,15, glm::vec4(0.172f,0.243f,0.314f,1.0f), "Exterior Wall"});
+
+     
+   // --- Interior partition walls ---
+        walls.push_back({400, 50, 5, 350, glm::vec4(0.365f,0.427f,0.494f,1.0f), "Interior  Wall"});
+	walls.push_back({400, 470, 5, 295, glm::vec4(0.365f,0.427f,0.494f,1.0f), "Interior  Wall"});
+        walls.push_back({850, 450, 3, 300, glm::vec4(0.365f,0.427f,0.494f,1.0f), "Interior Walll"});
+
+
+        // --- Kitchen ---
+        kitchen.push_back({100,100,200,80, glm::vec4(0.5f,0.55f,0.55f,1.0f), "Preperation Area"});
+        kitchen.push_back({100,200,150,60, glm::vec4(0.906f,0.298f,0.196f,1.0f), "Cooking"});
+        kitchen.push_back({100,280,120,50, glm::vec4(0.204f,0.596f,0.859f,1.0f), "Sink"});
+        kitchen.push_back({280,100,80,40, glm::vec4(0.608f,0.353f,0.714f,1.0f), "Hand Wash"});
+        kitchen.push_back({100,350,250,120, glm::vec4(0.204f,0.255f,0.369f,1.0f), "Storeroom"});
+
+	drains.push_back({150, 150, 6.0f, glm::vec4(0.0f,0.5f,1.0f,1.0f), "Drain 1"});
+	drains.push_back({200, 300, 6.0f, glm::vec4(0.0f,0.5f,1.0f,1.0f), "Drain 2"});
+	drains.push_back({300, 350, 6.0f, glm::vec4(0.0f,0.5f,1.0f,1.0f), "Drain 3"});
+
+        // --- Bar counter ---
+        bar.push_back({935,100,25,250, glm::vec4(0.827f,0.329f,0.0f,1.0f), "Bar Counter"});
+	for(int i=0;i<5;i++)
+           tablesCircle.push_back({920.0f, 120.0f + i*50.0f, 6.0f, glm::vec4(0.902f,0.494f,0.133f,1.0f), ""});
+        // --- Windows ---
+        windows.push_back({200,50,150,10, glm::vec4(0.204f,0.596f,0.859f,1.0f), "Window","A"});
+        windows.push_back({700,50,200,10, glm::vec4(0.204f,0.596f,0.859f,1.0f), "Window","A"});
+        windows.push_back({50,200,10,100, glm::vec4(0.204f,0.596f,0.859f,1.0f), "Window",""});
+        windows.push_back({500,755,200,10, glm::vec4(0.204f,0.596f,0.859f,1.0f), "Window","C"});
+        windows.push_back({1110,70,40,60, glm::vec4(0.529f,0.808f,0.922f,1.0f), "Men's Toilet Window"});
+        windows.push_back({1110,170,40,60, glm::vec4(0.529f,0.808f,0.922f,1.0f), "Women's Toilet Window"});
+
+        // --- Restrooms ---
+        restrooms.push_back({1030,50,120,100, glm::vec4(0.608f,0.357f,0.714f,1.0f), "Men's"});
+        restrooms.push_back({1030,150,120,100, glm::vec4(0.608f,0.357f,0.714f,1.0f), "Women's"});
+
+        // --- Doors ---
+        doors.push_back({500,50,80,10, "Main Entrance"});
+        doors.push_back({50,600,10,50, "Back Door"});
+        doors.push_back({1135,350,10,80, "Emergency Exit"});
+        doors.push_back({400,400,10,70, "Side Door"});
+        // --- Fire Equipment ---
+        fire.push_back({390,230,12,20, glm::vec4(0.906f,0.298f,0.196f,1.0f), "Fire Extinguisher"});
+        fire.push_back({400,490,12,20, glm::vec4(0.906f,0.298f,0.196f,1.0f), "Fire Extinguisher"});
         fire.push_back({920,50,12,20, glm::vec4(0.906f,0.298f,0.196f,1.0f), ""});
         fire.push_back({1138,450,12,20, glm::vec4(0.906f,0.298f,0.196f,1.0f), "Fire Extinguisher"});
 
-        // --- Rectangular Tables with Chairs ---
-        const float tableSize = 50.0f;
-        const float chairW = 12.0f, chairH = 20.0f;
-        const float leftX = 520.0f;
-        std::vector<float> leftY = {180.0f, 260.0f, 340.0f};
-        const float rightX = 680.0f;
-        std::vector<float> rightY = {180.0f, 260.0f, 340.0f};
+        // --- Rectangular Tables with Chairs ---
+        const float tableSize = 50.0f;
+        const float chairW = 12.0f, chairH = 20.0f;
+        const float leftX = 520.0f;
+        std::vector<float> leftY = {180.0f, 260.0f, 340.0f};
+        const float rightX = 680.0f;
+        std::vector<float> rightY = {180.0f, 260.0f, 340.0f};
+
+        for(auto &y: leftY){
+            tablesRect.push_back({leftX, y, tableSize, tableSize, glm::vec4(0.902f,0.494f,0.133f,1.0f), "Table"});
+            tablesRect.push_back({leftX - chairW, y + (tableSize-chairH)/2, chairW, chairH, glm::vec4(0.10f,0.54f,0.22f,1.0f), ""});
+            tablesRect.push_back({leftX + tableSize, y + (tableSize-chairH)/2, chairW, chairH, glm::vec4(0.10f,0.54f,0.22f,1.0f), ""});
+        }
+
+        for(auto &y: rightY){
+            tablesRect.push_back({rightX, y, tableSize, tableSize, glm::vec4(0.902f,0.494f,0.133f,1.0f), "Table"});
+            tablesRect.push_back({rightX - chairW, y + (tableSize-chairH)/2, chairW, chairH, glm::vec4(0.10f,0.54f,0.22f,1.0f), ""});
+            tablesRect.push_back({rightX + tableSize, y + (tableSize-chairH)/2, chairW, chairH, glm::vec4(0.10f,0.54f,0.22f,1.0f), ""});
+        }
+
+        // --- Round Tables ---
+        int numRound = 2;
+        float baseX = 550.0f;
+        float baseY = 600.0f;
+        float tableSpacing = 170.0f;
+        float tableRadius = 60.0f;
+        float chairDist = tableRadius + 15.0f;
+        for(int i=0;i<numRound;i++){
+            float tx = baseX + i*tableSpacing;
+            float ty = baseY;
+            tablesCircle.push_back({tx, ty, tableRadius, glm::vec4(0.55f,0.35f,0.2f,1.0f), "Table"});
+
+            for(int c=0;c<4;c++){
+                float angle = (float)c/4.0f * 2.0f * M_PI;
+                float cx = tx + cosf(angle)*chairDist;
+                float cy = ty + sinf(angle)*chairDist;
+                tablesRect.push_back({cx-chairW/2, cy-chairH/2, chairW, chairH, glm::vec4(0.10f,0.54f,0.22f,1.0f), "Chair"});
+            }
+        }
+
+        // --- Sofa Area ---
+        tablesRect.push_back({965, 710, 140, 40, glm::vec4(0.32f,0.20f,0.10f,1.0f), "Sofa"});
+        tablesRect.push_back({970, 715, 60, 30, glm::vec4(0.45f,0.30f,0.18f,1.0f), ""});
+        tablesRect.push_back({1040, 715, 60, 30, glm::vec4(0.45f,0.30f,0.18f,1.0f), ""});
+        tablesRect.push_back({1100, 550, 40, 150, glm::vec4(0.32f,0.20f,0.10f,1.0f), "Sofa"});
+        tablesRect.push_back({1105, 555, 30, 60, glm::vec4(0.45f,0.30f,0.18f,1.0f), ""});
+        tablesRect.push_back({1105, 635, 30, 60, glm::vec4(0.45f,0.30f,0.18f,1.0f), ""});
+        tablesRect.push_back({1000, 580, 80, 100, glm::vec4(0.6f,0.4f,0.2f,1.0f), "Coffee Table"});
+
+        // TV
+        walls.push_back({853, 550, 10, 100, glm::vec4(0.05f,0.05f,0.05f,1.0f), "TV"});
+
+        rebuildIndex();
+    }
+    // Parametric venue for benchmarks: a grid of 400x300 dining rooms, each with walls,
+    // a door, a window, an extinguisher, a drain and table groups with chairs, until about
+    // `targetItems` items exist. Labels are numbered so the string table and label caches
+    // grow with the layout. The same seed always gives the same layout.
+    void setupSyntheticLayout(size_t targetItems, uint32_t seed = 1){
+        setupEmptyLayout();
+        const float roomW = 400.0f, roomH = 300.0f;
+        const size_t itemsPerRoom = 34;
+        size_t rooms = std::max<size_t>(1, (targetItems + itemsPerRoom - 1) / itemsPerRoom);
+        int cols = std::max(1, (int)ceilf(sqrtf((float)rooms * roomH / roomW)));
+        int rows = (int)((rooms + cols - 1) / cols);
+        uint32_t state = seed ? seed : 1;
+        auto jitter = [&](float amount){ // xorshift32, deterministic across platforms
+            state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+            return ((state & 0xFFFF) / 65535.0f - 0.5f) * amount;
+        };
+        const glm::vec4 wallColor(0.365f,0.427f,0.494f,1.0f), tableColor(0.902f,0.494f,0.133f,1.0f);
+        const glm::vec4 chairColor(0.10f,0.54f,0.22f,1.0f), roundColor(0.55f,0.35f,0.2f,1.0f);
+        const float chairW = 12.0f, chairH = 20.0f, tableSize = 50.0f;
+        char label[32];
+
+        floor.push_back({0, 0, cols*roomW, rows*roomH, glm::vec4(0.172f, 0.243f, 0.314f, 1.0f), "Floor"});
+        size_t room = 0;
+        for(int ry=0; ry<rows && room<rooms; ry++){
+            for(int rx=0; rx<cols && room<rooms; rx++, room++){
+                float ox = rx*roomW, oy = ry*roomH;
+                walls.push_back({ox, oy, roomW, 5, wallColor, "Wall"});
+                walls.push_back({ox, oy, 5, roomH, wallColor, "Wall"});
+                walls.push_back({ox, oy+roomH-5, roomW*0.4f, 5, wallColor, "Wall"});
+                walls.push_back({ox+roomW*0.6f, oy+roomH-5, roomW*0.4f, 5, wallColor, "Wall"});
+                doors.push_back({ox+roomW*0.4f+5, oy+roomH-10, roomW*0.2f-10, 10, "", room%9==0 ? "Emergency Exit" : "Door"});
+                windows.push_back({ox+150, oy, 100, 10, glm::vec4(0.204f,0.596f,0.859f,1.0f), "Window", room%2 ? "A" : "B"});
+                fire.push_back({ox+8, oy+20, 12, 20, glm::vec4(0.906f,0.298f,0.196f,1.0f), "Fire Extinguisher"});
+                snprintf(label, sizeof(label), "Drain %zu", room);
+                drains.push_back({ox+30, oy+roomH-30, 6.0f, glm::vec4(0.0f,0.5f,1.0f,1.0f), label});
+                // Three square tables with two chairs each: 9 items.
+                for(int t=0;t<3;t++){
+                    float tx = ox + 60 + t*110 + jitter(10), ty = oy + 50 + jitter(10);
+                    snprintf(label, sizeof(label), "Table %zu-%d", room, t);
+                    tablesRect.push_back({tx, ty, tableSize, tableSize, tableColor, label});
+                    tablesRect.push_back({tx - chairW, ty + (tableSize-chairH)/2, chairW, chairH, chairColor, "Chair"});
+                    tablesRect.push_back({tx + tableSize, ty + (tableSize-chairH)/2, chairW, chairH, chairColor, "Chair"});
+                }
+                // Three round tables with four chairs each: 15 items.
+                for(int t=0;t<3;t++){
+                    float tx = ox + 85 + t*110 + jitter(10), ty = oy + 190 + jitter(10), r = 30.0f;
+                    snprintf(label, sizeof(label), "Round %zu-%d", room, t);
+                    tablesCircle.push_back({tx, ty, r, roundColor, label});
+                    for(int c=0;c<4;c++){
+                        float a = c * 0.5f * (float)M_PI;
+                        float cx = tx + cosf(a)*(r+12), cy = ty + sinf(a)*(r+12);
+                        tablesRect.push_back({cx-chairW/2, cy-chairH/2, chairW, chairH, chairColor, "Chair"});
+                    }
+                }
+                // Every fourth room is a lounge corner instead of a service room.
+                if(room%4==0){
+                    tablesRect.push_back({ox+300, oy+120, 80, 30, glm::vec4(0.32f,0.20f,0.10f,1.0f), "Sofa"});
+                    tablesRect.push_back({ox+305, oy+125, 35, 20, glm::vec4(0.45f,0.30f,0.18f,1.0f), ""});
+                    tablesRect.push_back({ox+340, oy+125, 35, 20, glm::vec4(0.45f,0.30f,0.18f,1.0f), ""});
+                }
+                else kitchen.push_back({ox+300, oy+120, 80, 40, glm::vec4(0.5f,0.55f,0.55f,1.0f), "Service"});
+            }
+        }
+        rebuildIndex();
+    }
+
+    // ---------------------- Item access and spatial queries ----------------------
+    const RectStore* rectCategory(uint8_t cat) const {
+        switch(cat){
+        case CAT_FLOOR: return &floor;       case CAT_WALL: return &walls;
+        case CAT_KITCHEN: return &kitchen;   case CAT_BAR: return &bar;
+        case CAT_WINDOW: return &windows;    case CAT_RESTROOM: return &restrooms;
+        case CAT_FIRE: return &fire;         case CAT_TABLE_RECT: return &tablesRect;
+        default: return nullptr;
+        }
+    }
+    const CircleStore* circleCategory(uint8_t cat) const {
+        return cat==CAT_TABLE_CIRCLE ? &tablesCircle : cat==CAT_DRAIN ? &drains : nullptr;
+    }
+    size_t categorySize(uint8_t cat) const {
+        if(auto* r = rectCategory(cat)) return r->size();
+        if(auto* c = circleCategory(cat)) return c->size();
+        return cat==CAT_DOOR ? doors.size() : 0;
+    }
+    ItemBounds itemBounds(ItemRef r) const {
+        if(auto* v = rectCategory(r.cat)){ size_t i = r.index; return {v->x[i], v->y[i], v->x[i]+v->w[i], v->y[i]+v->h[i]}; }
+        if(auto* v = circleCategory(r.cat)){ size_t i = r.index; return {v->x[i]-v->r[i], v->y[i]-v->r[i], v->x[i]+v->r[i], v->y[i]+v->r[i]}; }
+        size_t i = r.index;
+        return {doors.x[i], doors.y[i], doors.x[i]+doors.w[i], doors.y[i]+doors.h[i]};
+    }
+    const std::string &itemLabel(ItemRef r) const {
+        if(auto* v = rectCategory(r.cat)) return strings.str(v->label[r.index]);
+        if(auto* v = circleCategory(r.cat)) return strings.str(v->label[r.index]);
+        return strings.str(doors.label[r.index]);
+    }
+
+    // Union of all item bounds, at least the 1200x800 design area.
+    ItemBounds layoutBounds() const {
+        ItemBounds b{0.0f, 0.0f, 1200.0f, 800.0f};
+        for(uint8_t c=0;c<CAT_COUNT;c++)
+            for(uint32_t i=0;i<categorySize(c);i++){
+                ItemBounds ib = itemBounds({c,i});
+                b = {std::min(b.x0, ib.x0), std::min(b.y0, ib.y0), std::max(b.x1, ib.x1), std::max(b.y1, ib.y1)};
+            }
+        return b;
+    }
+    void rebuildIndex(){
+        // Sized to the layout: items clamped into border cells would make large venues
+        // degrade to linear scans.
+        index.reset(layoutBounds(), 50.0f);
+        layoutRevision++;
+        for(uint8_t c=0;c<CAT_COUNT;c++)
+            for(uint32_t i=0;i<categorySize(c);i++) index.insert({c,i}, itemBounds({c,i}));
+        submitEgressFull();
+        rebuildSeating();
+    }
+    // ---------------------- Layout load / save ----------------------
+    // Calls fn(column, holdsStringIds) for every column of a category, in file order.
+    template<class F> void visitColumns(uint8_t cat, F &&fn){
+        if(RectStore *r = const_cast<RectStore*>(rectCategory(cat))){
+            fn(r->x,false); fn(r->y,false); fn(r->w,false); fn(r->h,false); fn(r->rgba,false); fn(r->label,true); fn(r->type,true);
+        } else if(CircleStore *c = const_cast<CircleStore*>(circleCategory(cat))){
+            fn(c->x,false); fn(c->y,false); fn(c->r,false); fn(c->rgba,false); fn(c->label,true);
+        } else {
+            fn(doors.x,false); fn(doors.y,false); fn(doors.w,false); fn(doors.h,false); fn(doors.hinge,true); fn(doors.label,true);
+        }
+    }
+    void resizeColdColumns(){
+        for(uint8_t c=0;c<CAT_COUNT;c++){
+            if(auto* r = rectCategory(c)) const_cast<RectStore*>(r)->resizeCold();
+            else if(auto* ci = circleCategory(c)) const_cast<CircleStore*>(ci)->resizeCold();
+        }
+        doors.resizeCold();
+    }
+    static bool hasSuffix(const std::string &s, const char *suffix){
+        size_t n = strlen(suffix);
+        return s.size() >= n && s.compare(s.size()-n, n, suffix)==0;
+    }
+    // .json goes through the authoring format, anything else is the binary layout.
+    bool loadLayout(const std::string &path){ return hasSuffix(path, ".json") ? importJson(path) : loadBinaryLayout(path); }
+    bool saveLayout(const std::string &path){ return hasSuffix(path, ".json") ? exportJson(path) : saveBinaryLayout(path); }
 
-        for(auto &y: leftY){
-            tablesRect.push_back({leftX, y, tableSize, tableSize, glm::vec4(0.902f,0.494f,0.133f,1.0f), "Table"});
-            tablesRect.push_back({leftX - chairW, y + (tableSize-chairH)/2, chairW, chairH, glm::vec4(0.10f,0.54f,0.22f,1.0f), ""});
-            tablesRect.push_back({leftX + tableSize, y + (tableSize-chairH)/2, chairW, chairH, glm::vec4(0.10f,0.54f,0.22f,1.0f), ""});
+    // The binary layout as one byte image; saveBinaryLayout writes it, frame captures embed it.
+    std::vector<unsigned char> encodeBinaryLayout(){
+        LayoutFileHeader hdr{};
+        hdr.magic = LAYOUT_MAGIC; hdr.version = LAYOUT_VERSION; hdr.categoryCount = CAT_COUNT;
+        std::vector<unsigned char> buf(sizeof(hdr));
+        auto put = [&](const void *src, size_t bytes) -> uint64_t {
+            buf.resize((buf.size()+15) & ~(size_t)15);
+            uint64_t at = buf.size();
+            buf.insert(buf.end(), (const unsigned char*)src, (const unsigned char*)src + bytes);
+            return at;
+        };
+        for(uint8_t c=0;c<CAT_COUNT;c++){
+            LayoutSection &sec = hdr.sections[c];
+            sec.count = (uint32_t)categorySize(c);
+            visitColumns(c, [&](auto &col, bool){ sec.columnAt[sec.columnCount++] = put(col.data(), col.size()*sizeof(col[0])); });
+        }
+        std::vector<uint32_t> offsets(1, 0);
+        std::string blob;
+        for(size_t i=0;i<strings.size();i++){ blob += strings.str((uint32_t)i); offsets.push_back((uint32_t)blob.size()); }
+        hdr.stringCount = (uint32_t)strings.size();
+        hdr.stringOffsetsAt = put(offsets.data(), offsets.size()*sizeof(uint32_t));
+        hdr.stringBlobAt = put(blob.data(), blob.size());
+        hdr.fileSize = buf.size();
+        memcpy(buf.data(), &hdr, sizeof(hdr));
+        return buf;
+    }
+    bool saveBinaryLayout(const std::string &path){
+        std::vector<unsigned char> buf = encodeBinaryLayout();
+        std::string tmp = path + ".tmp";
+        FILE* f = fopen(tmp.c_str(), "wb");
+        if(!f){ std::cerr<<"Layout: cannot write "<<tmp<<"\n"; return false; }
+        bool ok = fwrite(buf.data(), 1, buf.size(), f)==buf.size();
+        ok = (fclose(f)==0) && ok;
+        if(ok) ok = rename(tmp.c_str(), path.c_str())==0;
+        if(!ok){ remove(tmp.c_str()); std::cerr<<"Layout: failed to write "<<path<<"\n"; }
+        return ok;
+    }
+
+    // Maps the file and points every item column at it; nothing per item is parsed or
+    // allocated beyond validating string ids. Cold overlay caches are sized once.
+    bool loadBinaryLayout(const std::string &path){
+        MappedFile file;
+        if(!file.open(path)){ std::cerr<<"Layout: cannot open "<<path<<"\n"; return false; }
+        return adoptBinaryLayout(file, path);
+    }
+    bool loadBinaryLayout(std::vector<unsigned char> &&bytes, const std::string &name){
+        MappedFile file;
+        file.adopt(std::move(bytes));
+        return adoptBinaryLayout(file, name);
+    }
+    // Validates a layout image and points every column at it; `file` is taken over on success.
+    bool adoptBinaryLayout(MappedFile &file, const std::string &path){
+        if(file.size < sizeof(LayoutFileHeader)){ std::cerr<<"Layout: "<<path<<" is truncated\n"; return false; }
+        LayoutFileHeader hdr;
+        memcpy(&hdr, file.data, sizeof(hdr));
+        if(hdr.magic!=LAYOUT_MAGIC || hdr.version!=LAYOUT_VERSION || hdr.categoryCount!=CAT_COUNT || hdr.fileSize!=file.size){
+            std::cerr<<"Layout: "<<path<<" is not a version "<<LAYOUT_VERSION<<" layout\n"; return false;
+        }
+        auto inFile = [&](uint64_t at, uint64_t bytes){ return at <= file.size && bytes <= file.size - at; };
+
+        // String table
+        if(hdr.stringCount==0 || !inFile(hdr.stringOffsetsAt, ((uint64_t)hdr.stringCount+1)*4) || hdr.stringOffsetsAt % 4){
+            std::cerr<<"Layout: bad string table in "<<path<<"\n"; return false;
+        }
+        const uint32_t *offsets = (const uint32_t*)(file.data + hdr.stringOffsetsAt);
+        if(!inFile(hdr.stringBlobAt, offsets[hdr.stringCount])){ std::cerr<<"Layout: bad string table in "<<path<<"\n"; return false; }
+        const char *blob = (const char*)(file.data + hdr.stringBlobAt);
+        StringTable table;
+        for(uint32_t i=1;i<hdr.stringCount;i++){
+            if(offsets[i] < offsets[i-1] || offsets[i+1] < offsets[i] ||
+               table.intern(std::string(blob+offsets[i], offsets[i+1]-offsets[i])) != i){
+                std::cerr<<"Layout: bad string table in "<<path<<"\n"; return false;
+            }
+        }
+
+        // Columns
+        bool ok = true;
+        for(uint8_t c=0;c<CAT_COUNT && ok;c++){
+            const LayoutSection &sec = hdr.sections[c];
+            uint32_t k = 0;
+            visitColumns(c, [&](auto &col, bool ids){
+                using T = typename std::decay_t<decltype(col)>::value_type;
+                if(!ok) return;
+                uint64_t at = k < sec.columnCount && k < (uint32_t)LAYOUT_MAX_COLUMNS ? sec.columnAt[k] : 0;
+                k++;
+                if(at % 4 || !inFile(at, (uint64_t)sec.count*4)){ ok = false; return; }
+                if(ids){
+                    const uint32_t *id = (const uint32_t*)(file.data + at);
+                    for(uint32_t i=0;i<sec.count;i++) if(id[i] >= hdr.stringCount){ ok = false; return; }
+                }
+                if(std::is_same<T, float>::value){ // NaN/inf geometry would poison bounds and grids
+                    const float *v = (const float*)(file.data + at);
+                    for(uint32_t i=0;i<sec.count;i++) if(!std::isfinite(v[i])){ ok = false; return; }
+                }
+            });
+            ok = ok && k==sec.columnCount;
+        }
+        if(!ok){ std::cerr<<"Layout: bad item columns in "<<path<<"\n"; return false; }
+
+        strings = std::move(table);
+        for(uint8_t c=0;c<CAT_COUNT;c++){
+            const LayoutSection &sec = hdr.sections[c];
+            uint32_t k = 0;
+            visitColumns(c, [&](auto &col, bool){
+                using T = typename std::decay_t<decltype(col)>::value_type;
+                col.borrow((const T*)(file.data + sec.columnAt[k++]), sec.count);
+            });
+        }
+        resizeColdColumns();
+        layoutFile.swap(file); // the previous mapping (if any) is released with `file`
+        resetEditState();
+        markGeometryDirty();
+        rebuildIndex();
+        return true;
+    }
+
+    bool exportJson(const std::string &path){
+        std::string out = "{\n  \"version\": 1";
+        char num[32];
+        auto field = [&](const char *key, float v){ snprintf(num, sizeof(num), "%.9g", v); out += "\""; out += key; out += "\": "; out += num; out += ", "; };
+        auto textField = [&](const char *key, const std::string &v, bool last){ out += "\""; out += key; out += "\": "; jsonEscape(out, v); if(!last) out += ", "; };
+        for(uint8_t c=0;c<CAT_COUNT;c++){
+            out += ",\n  \""; out += kCategoryNames[c]; out += "\": [";
+            size_t n = categorySize(c);
+            for(size_t i=0;i<n;i++){
+                out += i ? ",\n    {" : "\n    {";
+                if(auto* r = rectCategory(c)){
+                    RectView v = (*r)[i];
+                    field("x", v.x); field("y", v.y); field("w", v.w); field("h", v.h);
+                    textField("color", colorHex(v.rgba), false); textField("label", v.label, false); textField("type", v.type, true);
+                } else if(auto* ci = circleCategory(c)){
+                    CircleView v = (*ci)[i];
+                    field("x", v.x); field("y", v.y); field("r", v.r);
+                    textField("color", colorHex(v.rgba), false); textField("label", v.label, true);
+                } else {
+                    DoorView v = doors[i];
+                    field("x", v.x); field("y", v.y); field("w", v.w); field("h", v.h);
+                    textField("hinge", v.hinge, false); textField("label", v.label, true);
+                }
+                out += "}";
+            }
+            out += n ? "\n  ]" : "]";
+        }
+        out += "\n}\n";
+        FILE* f = fopen(path.c_str(), "wb");
+        if(!f){ std::cerr<<"Layout: cannot write "<<path<<"\n"; return false; }
+        bool ok = fwrite(out.data(), 1, out.size(), f)==out.size();
+        ok = (fclose(f)==0) && ok;
+        if(!ok) std::cerr<<"Layout: failed to write "<<path<<"\n";
+        return ok;
+    }
+
+    bool importJson(const std::string &path){
+        FILE* f = fopen(path.c_str(), "rb");
+        if(!f){ std::cerr<<"Layout: cannot open "<<path<<"\n"; return false; }
+        std::string text;
+        char chunk[4096]; size_t n;
+        while((n = fread(chunk, 1, sizeof(chunk), f)) > 0) text.append(chunk, n);
+        fclose(f);
+
+        JsonValue root;
+        JsonParser parser{text.data(), text.data()+text.size(), {}};
+        if(!parser.parseDocument(root) || root.type!=JsonValue::OBJECT){
+            std::cerr<<"Layout: "<<path<<": "<<(parser.error.empty() ? "expected an object" : parser.error)<<"\n"; return false;
+        }
+        setupEmptyLayout();
+        for(uint8_t c=0;c<CAT_COUNT;c++){
+            const JsonValue *arr = root.get(kCategoryNames[c]);
+            if(!arr || arr->type!=JsonValue::ARRAY) continue;
+            for(const JsonValue &it: arr->items){
+                if(it.type!=JsonValue::OBJECT) continue;
+                if(auto* r = rectCategory(c))
+                    const_cast<RectStore*>(r)->push_back({it.num("x"), it.num("y"), it.num("w"), it.num("h"),
+                        parseColorHex(it.text("color")), it.text("label"), it.text("type", "A")});
+                else if(auto* ci = circleCategory(c))
+                    const_cast<CircleStore*>(ci)->push_back({it.num("x"), it.num("y"), it.num("r"),
+                        parseColorHex(it.text("color")), it.text("label")});
+                else
+                    doors.push_back({it.num("x"), it.num("y"), it.num("w"), it.num("h"), it.text("hinge"), it.text("label")});
+            }
+        }
+        rebuildIndex();
+        return true;
+    }
+
+    // Call after editing an item's geometry in place.
+    void itemChanged(ItemRef r){
+        layoutRevision++;
+        index.update(r, itemBounds(r));
+        patchItemGeometry(r);
+        submitEgressMove(r);
+        seatItemChanged(r);
+    }
+
+    // ---------------------- Seating ----------------------
+    // Round tables are circles of at least 15 units (smaller ones are stools); rects are
+    // typed by label first ("Sofa", "Chair", "Table"...) and when unlabelled by their
+    // shorter side, which is what sets chairs and sofa cushions apart from tables.
+    void classifySeat(ItemRef r, SeatIndex::Entry &e){
+        e.role = SeatIndex::ROLE_NONE;
+        ItemBounds b = itemBounds(r);
+        if(r.cat==CAT_TABLE_CIRCLE){
+            e.role = b.x1 - b.x0 >= 30.0f ? SeatIndex::ROLE_TABLE : SeatIndex::ROLE_SEAT;
+            e.kind = TK_ROUND;
+        } else {
+            const std::string &label = itemLabel(r);
+            auto has = [&](const char *word){ return label.find(word) != std::string::npos; };
+            e.kind = TK_RECT;
+            if(has("Sofa")){ e.role = SeatIndex::ROLE_TABLE; e.kind = TK_SOFA; }
+            else if(has("Chair") || has("Seat") || has("Stool")) e.role = SeatIndex::ROLE_SEAT;
+            else if(has("Table")) e.role = SeatIndex::ROLE_TABLE;
+            else e.role = std::min(b.x1 - b.x0, b.y1 - b.y0) <= 30.0f ? SeatIndex::ROLE_SEAT : SeatIndex::ROLE_TABLE; // chairs, cushions
+        }
+        float cx = (b.x0 + b.x1)*0.5f, cy = (b.y0 + b.y1)*0.5f;
+        e.zone = (uint32_t)floor.size();
+        index.query({cx, cy, cx, cy}, [&](ItemRef f, const ItemBounds &){
+            if(f.cat==CAT_FLOOR && (e.zone==floor.size() || f.index > e.zone)) e.zone = f.index; // topmost floor wins
+        });
+    }
+    // Nearest table whose edge is within SEAT_REACH of the seat's centre; ties go to the
+    // lower index so the result doesn't depend on edit order.
+    ItemRef nearestTable(ItemRef seat){
+        ItemBounds b = itemBounds(seat);
+        float cx = (b.x0 + b.x1)*0.5f, cy = (b.y0 + b.y1)*0.5f;
+        const float reach = SeatIndex::SEAT_REACH;
+        ItemRef best;
+        float bestGap = FLT_MAX;
+        index.query(ItemBounds{cx, cy, cx, cy}.expanded(reach), [&](ItemRef r, const ItemBounds &t){
+            if((r.cat!=CAT_TABLE_RECT && r.cat!=CAT_TABLE_CIRCLE) || r==seat) return;
+            if(seating.at(r).role != SeatIndex::ROLE_TABLE) return;
+            float gap;
+            if(r.cat==CAT_TABLE_CIRCLE){
+                float dx = cx - (t.x0 + t.x1)*0.5f, dy = cy - (t.y0 + t.y1)*0.5f;
+                gap = std::max(0.0f, sqrtf(dx*dx + dy*dy) - (t.x1 - t.x0)*0.5f);
+            } else {
+                float dx = std::max(0.0f, std::max(t.x0 - cx, cx - t.x1)), dy = std::max(0.0f, std::max(t.y0 - cy, cy - t.y1));
+                gap = sqrtf(dx*dx + dy*dy);
+            }
+            if(gap > reach) return;
+            if(gap < bestGap || (gap == bestGap && (r.cat < best.cat || (r.cat == best.cat && r.index < best.index)))){ bestGap = gap; best = r; }
+        });
+        return best;
+    }
+    void rebuildSeating(){
+        seating.zoneNames.clear();
+        for(uint32_t i=0;i<floor.size();i++) seating.zoneNames.push_back(itemLabel({CAT_FLOOR, i}) + " " + std::to_string(i+1));
+        seating.zoneNames.push_back("Outside");
+        seating.clear(tablesRect.size(), tablesCircle.size(), seating.zoneNames.size());
+        const uint8_t cats[2] = {CAT_TABLE_RECT, CAT_TABLE_CIRCLE};
+        for(uint8_t c: cats) for(uint32_t i=0;i<categorySize(c);i++){
+            ItemRef r{c, i};
+            SeatIndex::Entry &e = seating.at(r);
+            classifySeat(r, e);
+            if(e.role==SeatIndex::ROLE_TABLE) seating.count(r, 1);
+        }
+        for(uint8_t c: cats) for(uint32_t i=0;i<categorySize(c);i++){
+            ItemRef r{c, i};
+            if(seating.at(r).role==SeatIndex::ROLE_SEAT) seating.link(r, nearestTable(r));
+        }
+    }
+    // Re-types a moved or resized item and relinks only the seats it can affect: its
+    // own, the ones that were at it (if a table) and the ones now within reach of it.
+    void seatItemChanged(ItemRef r){
+        if(r.cat==CAT_FLOOR){ rebuildSeating(); return; } // zones moved
+        if(r.cat!=CAT_TABLE_RECT && r.cat!=CAT_TABLE_CIRCLE) return;
+        SeatIndex::Entry &e = seating.at(r);
+        std::vector<ItemRef> relink;
+        if(e.role==SeatIndex::ROLE_TABLE){
+            relink.swap(e.children);
+            for(ItemRef s: relink){ seating.count(s, -1); seating.at(s).parent = ItemRef(); }
+        } else if(e.role==SeatIndex::ROLE_SEAT) seating.unlink(r);
+        seating.count(r, -1);
+        classifySeat(r, e);
+        if(e.role==SeatIndex::ROLE_TABLE){
+            seating.count(r, 1);
+            index.query(itemBounds(r).expanded(SeatIndex::SEAT_REACH), [&](ItemRef s, const ItemBounds &){
+                if((s.cat==CAT_TABLE_RECT || s.cat==CAT_TABLE_CIRCLE) && seating.at(s).role==SeatIndex::ROLE_SEAT && seating.at(s).counted)
+                    relink.push_back(s);
+            });
+        } else if(e.role==SeatIndex::ROLE_SEAT) relink.push_back(r);
+        for(ItemRef s: relink){ seating.unlink(s); seating.link(s, nearestTable(s)); }
+    }
+    void drawSeatingDetail(){
+        const SeatTotals &t = seating.total;
+        ImGui::Text("This floor: %u seats at %u tables (%u loose)", t.seats, t.tables, t.loose);
+        for(int k=0;k<TK_COUNT;k++)
+            if(seating.byKind[k].tables) ImGui::Text("  %s: %u tables, %u seats", TABLE_KIND_NAMES[k], seating.byKind[k].tables, seating.byKind[k].seats);
+        for(size_t z=0;z<seating.byZone.size();z++){
+            const SeatTotals &zt = seating.byZone[z];
+            if(zt.tables || zt.seats) ImGui::Text("  %s: %u seats at %u tables", seating.zoneNames[z].c_str(), zt.seats, zt.tables);
+        }
+    }
+
+    // ---------------------- Egress analysis ----------------------
+    // Doors labelled as exits, or set in the outer wall of their floor (within a wall's
+    // thickness of its edge), lead outside.
+    bool isExitDoor(uint32_t i){
+        const std::string &label = itemLabel({CAT_DOOR, i});
+        if(label.find("Exit") != std::string::npos || label.find("Entrance") != std::string::npos) return true;
+        const float edge = 20.0f;
+        ItemBounds d = itemBounds({CAT_DOOR, i});
+        bool exit = false;
+        index.query(d.expanded(edge), [&](ItemRef r, const ItemBounds &f){
+            if(r.cat!=CAT_FLOOR || !f.expanded(edge).contains(d)) return;
+            if(d.x0-f.x0 < edge || f.x1-d.x1 < edge || d.y0-f.y0 < edge || f.y1-d.y1 < edge) exit = true;
+        });
+        return exit;
+    }
+    // Windows, restrooms and drains neither block nor help; all fire equipment is
+    // counted as an extinguisher.
+    EgressShape egressShape(ItemRef r){
+        EgressShape s;
+        s.b = itemBounds(r);
+        switch(r.cat){
+        case CAT_FLOOR: s.role = ER_FLOOR; break;
+        case CAT_WALL: case CAT_KITCHEN: case CAT_BAR: case CAT_TABLE_RECT: s.role = ER_OBSTACLE; break;
+        case CAT_TABLE_CIRCLE: s.role = ER_OBSTACLE; s.circle = true; break;
+        case CAT_DOOR: s.role = isExitDoor(r.index) ? ER_EXIT : ER_DOOR; break;
+        case CAT_FIRE: s.role = ER_EXTINGUISHER; break;
+        default: break;
+        }
+        return s;
+    }
+    void submitEgressFull(){
+        if(!analyseEgress) return;
+        EgressEngine::Job job;
+        job.full = true;
+        job.settings = egressSettings;
+        job.area = egressArea = layoutBounds();
+        job.revision = layoutRevision;
+        for(uint8_t c=0;c<CAT_COUNT;c++){
+            job.shapes[c].reserve(categorySize(c));
+            for(uint32_t i=0;i<categorySize(c);i++) job.shapes[c].push_back(egressShape({c,i}));
+        }
+        egress->submit(std::move(job));
+    }
+    void submitEgressMove(ItemRef r){
+        if(!analyseEgress) return;
+        // A floor moving changes which doors are exits; anything leaving the grid needs a
+        // bigger one.
+        if(r.cat==CAT_FLOOR || !egressArea.contains(itemBounds(r))){ submitEgressFull(); return; }
+        EgressEngine::Job job;
+        job.ref = r;
+        job.shape = egressShape(r);
+        job.revision = layoutRevision;
+        egress->submit(std::move(job));
+    }
+    void drawEgress(ImDrawList* dl){
+        if(!analyseEgress) return;
+        EgressReport r = egress->latest();
+        if(!r.valid) return;
+        ScreenTransform t = ScreenTransform::fromProjection(proj, canvasW, canvasH);
+        for(const ImVec2 &p: r.narrowSpots)
+            dl->AddCircleFilled(ImVec2(p.x*t.ax + t.bx, p.y*t.ay + t.by), 4.0f, IM_COL32(220,0,220,200));
+        if(r.worstTravel > 0.0f){
+            ImVec2 w(r.worstAt.x*t.ax + t.bx, r.worstAt.y*t.ay + t.by);
+            ImU32 col = r.worstTravel > egressSettings.maxTravel ? IM_COL32(230,0,0,255) : IM_COL32(0,160,0,255);
+            dl->AddCircle(w, 8.0f, col, 0, 2.0f);
+            dl->AddLine(ImVec2(w.x-5, w.y), ImVec2(w.x+5, w.y), col, 2.0f);
+            dl->AddLine(ImVec2(w.x, w.y-5), ImVec2(w.x, w.y+5), col, 2.0f);
+        }
+    }
+    void drawEgressControls(){
+        if(!ImGui::CollapsingHeader("Egress")) return;
+        bool changed = ImGui::Checkbox("Analyse Egress", &analyseEgress);
+        EgressSettings s = egressSettings;
+        ImGui::SliderFloat("Grid Cell", &s.cell, 5.0f, 50.0f, "%.0f");
+        ImGui::SliderFloat("Min Corridor", &s.minCorridor, 50.0f, 300.0f, "%.0f");
+        ImGui::SliderFloat("Max Travel", &s.maxTravel, 500.0f, 10000.0f, "%.0f");
+        ImGui::SliderFloat("Extinguisher Reach", &s.extinguisherReach, 500.0f, 5000.0f, "%.0f");
+        if(!(s == egressSettings)){ egressSettings = s; changed = true; }
+        if(changed) submitEgressFull();
+        if(!analyseEgress) return;
+        EgressReport r = egress->latest();
+        if(!r.valid){ ImGui::TextUnformatted("Computing..."); return; }
+        double walk = std::max<size_t>(r.walkable, 1);
+        ImGui::Text("Worst travel %.1f m (limit %.1f m)", r.worstTravel/100.0f, egressSettings.maxTravel/100.0f);
+        ImGui::Text("Over limit %.1f%%, no exit %.1f%%", 100.0*r.tooFar/walk, 100.0*r.unreachable/walk);
+        ImGui::Text("Extinguisher coverage %.1f%%", 100.0 - 100.0*r.uncovered/walk);
+        ImGui::Text("Narrow passages: %zu cells, %zu spots", r.narrow, r.narrowSpots.size());
+        ImGui::Text("%dx%d @ %.0f, %s %.2f ms, %zu cells%s", r.cols, r.rows, r.cell,
+                    r.incremental ? "patched" : "full", r.ms, r.repaired, r.revision != layoutRevision ? " (updating)" : "");
+    }
+
+    // ---------------------- Editing ----------------------
+    ItemGeom getGeom(ItemRef r) const {
+        ItemGeom g;
+        size_t i = r.index;
+        if(auto* v = rectCategory(r.cat)){ g.v[0]=v->x[i]; g.v[1]=v->y[i]; g.v[2]=v->w[i]; g.v[3]=v->h[i]; }
+        else if(auto* v = circleCategory(r.cat)){ g.v[0]=v->x[i]; g.v[1]=v->y[i]; g.v[2]=v->r[i]; }
+        else { g.v[0]=doors.x[i]; g.v[1]=doors.y[i]; g.v[2]=doors.w[i]; g.v[3]=doors.h[i]; }
+        return g;
+    }
+    void setGeom(ItemRef r, const ItemGeom &g){
+        size_t i = r.index;
+        if(auto* cv = rectCategory(r.cat)){ auto* v = const_cast<RectStore*>(cv); v->x.set(i,g.v[0]); v->y.set(i,g.v[1]); v->w.set(i,g.v[2]); v->h.set(i,g.v[3]); }
+        else if(auto* cv = circleCategory(r.cat)){ auto* v = const_cast<CircleStore*>(cv); v->x.set(i,g.v[0]); v->y.set(i,g.v[1]); v->r.set(i,g.v[2]); }
+        else { doors.x.set(i,g.v[0]); doors.y.set(i,g.v[1]); doors.w.set(i,g.v[2]); doors.h.set(i,g.v[3]); }
+        itemChanged(r);
+    }
+    ItemRow readRow(ItemRef r) const {
+        ItemRow row;
+        if(auto* v = rectCategory(r.cat)) row.rect = v->row(r.index);
+        else if(auto* v = circleCategory(r.cat)) row.circle = v->row(r.index);
+        else row.door = doors.row(r.index);
+        return row;
+    }
+    // Insertion and removal shift the indices after r, so the index and geometry are
+    // rebuilt; both are rare next to moves.
+    void insertRow(ItemRef r, const ItemRow &row){
+        if(auto* v = rectCategory(r.cat)) const_cast<RectStore*>(v)->insert(r.index, row.rect);
+        else if(auto* v = circleCategory(r.cat)) const_cast<CircleStore*>(v)->insert(r.index, row.circle);
+        else doors.insert(r.index, row.door);
+        rebuildIndex(); markGeometryDirty();
+    }
+    void eraseRow(ItemRef r){
+        if(auto* v = rectCategory(r.cat)) const_cast<RectStore*>(v)->erase(r.index);
+        else if(auto* v = circleCategory(r.cat)) const_cast<CircleStore*>(v)->erase(r.index);
+        else doors.erase(r.index);
+        if(selected.valid() && selected.cat==r.cat){
+            if(selected.index==r.index) selected = ItemRef();
+            else if(selected.index > r.index) selected.index--;
+        }
+        rebuildIndex(); markGeometryDirty();
+    }
+    void resetEditState(){ undoStack.clear(); redoStack.clear(); selected = ItemRef(); dragMode = DRAG_NONE; }
+    void record(EditDelta &&d){ undoStack.push_back(std::move(d)); redoStack.clear(); }
+
+    // Appends a new item to its category and selects it.
+    void addItem(uint8_t cat, const ItemRow &row){
+        ItemRef r{cat, (uint32_t)categorySize(cat)};
+        insertRow(r, row);
+        EditDelta d; d.kind = EditDelta::ADD; d.ref = r; d.row.reset(new ItemRow(row));
+        record(std::move(d));
+        selected = r;
+    }
+    void deleteSelected(){
+        if(!selected.valid()) return;
+        EditDelta d; d.kind = EditDelta::REMOVE; d.ref = selected; d.row.reset(new ItemRow(readRow(selected)));
+        eraseRow(selected);
+        record(std::move(d));
+    }
+    // Applies d forwards (redo) or backwards (undo).
+    void applyDelta(const EditDelta &d, bool forward){
+        switch(d.kind){
+        case EditDelta::GEOMETRY: setGeom(d.ref, forward ? d.after : d.before); selected = d.ref; break;
+        case EditDelta::ADD:      if(forward){ insertRow(d.ref, *d.row); selected = d.ref; } else eraseRow(d.ref); break;
+        case EditDelta::REMOVE:   if(forward) eraseRow(d.ref); else { insertRow(d.ref, *d.row); selected = d.ref; } break;
+        }
+    }
+    void undo(){
+        if(undoStack.empty()) return;
+        applyDelta(undoStack.back(), false);
+        redoStack.push_back(std::move(undoStack.back())); undoStack.pop_back();
+    }
+    void redo(){
+        if(redoStack.empty()) return;
+        applyDelta(redoStack.back(), true);
+        undoStack.push_back(std::move(redoStack.back())); redoStack.pop_back();
+    }
+
+    // Pointer editing in world coordinates: press selects (or grabs the resize handle of
+    // the selection), drag moves/resizes, release records one delta for the gesture.
+    void editPointerDown(float wx, float wy){
+        dragMode = DRAG_NONE;
+        if(selected.valid()){
+            ItemBounds b = itemBounds(selected);
+            float handle = 6.0f / scaleX;
+            if(fabsf(wx - b.x1) <= handle && fabsf(wy - b.y1) <= handle) dragMode = DRAG_RESIZE;
+        }
+        if(dragMode == DRAG_NONE){
+            selected = hitTest(wx, wy);
+            if(selected.valid()) dragMode = DRAG_MOVE;
+        }
+        if(dragMode != DRAG_NONE){ dragStart = getGeom(selected); dragAnchor = glm::vec2(wx, wy); }
+    }
+    void editPointerDrag(float wx, float wy){
+        if(dragMode == DRAG_NONE || !selected.valid()) return;
+        ItemGeom g = dragStart;
+        float dx = wx - dragAnchor.x, dy = wy - dragAnchor.y;
+        bool circle = circleCategory(selected.cat) != nullptr;
+        if(dragMode == DRAG_MOVE){ g.v[0] += dx; g.v[1] += dy; }
+        else if(circle) g.v[2] = std::max(2.0f, dragStart.v[2] + std::max(dx, dy));
+        else { g.v[2] = std::max(2.0f, dragStart.v[2] + dx); g.v[3] = std::max(2.0f, dragStart.v[3] + dy); }
+        if(!(g == getGeom(selected))) setGeom(selected, g);
+    }
+    void editPointerUp(){
+        if(dragMode != DRAG_NONE && selected.valid()){
+            ItemGeom now = getGeom(selected);
+            if(!(now == dragStart)){
+                EditDelta d; d.kind = EditDelta::GEOMETRY; d.ref = selected; d.before = dragStart; d.after = now;
+                record(std::move(d));
+            }
+        }
+        dragMode = DRAG_NONE;
+    }
+    void drawSelection(ImDrawList* dl){
+        if(!editMode || !selected.valid()) return;
+        ScreenTransform t = ScreenTransform::fromProjection(proj, canvasW, canvasH);
+        ItemBounds b = itemBounds(selected);
+        ImVec2 p0(b.x0*t.ax + t.bx, b.y0*t.ay + t.by), p1(b.x1*t.ax + t.bx, b.y1*t.ay + t.by);
+        dl->AddRect(p0, p1, IM_COL32(0,120,255,255), 0.0f, 0, 2.0f);
+        dl->AddRectFilled(ImVec2(p1.x-4, p1.y-4), ImVec2(p1.x+4, p1.y+4), IM_COL32(0,120,255,255)); // resize handle
+    }
+
+    // Topmost item under a world-space point (exact circle test for round items).
+    ItemRef hitTest(float wx, float wy){
+        ItemRef best;
+        index.query({wx, wy, wx, wy}, [&](ItemRef r, const ItemBounds &){
+            if(r.cat==CAT_FLOOR) return;
+            if(auto* v = circleCategory(r.cat)){
+                float dx = wx - v->x[r.index], dy = wy - v->y[r.index], cr = v->r[r.index];
+                if(dx*dx + dy*dy > cr*cr) return;
+            }
+            if(!best.valid() || r.cat > best.cat || (r.cat==best.cat && r.index > best.index)) best = r;
+        });
+        return best;
+    }
+    // Items (other than the floor) whose bounds come within `clearance` of r's bounds.
+    std::vector<ItemRef> findOverlaps(ItemRef r, float clearance){
+        std::vector<ItemRef> out;
+        index.query(itemBounds(r).expanded(clearance), [&](ItemRef o, const ItemBounds &){
+            if(!(o==r) && o.cat!=CAT_FLOOR) out.push_back(o);
+        });
+        return out;
+    }
+
+    // World-space rectangle currently covered by the canvas.
+    ItemBounds viewBounds() const {
+        ScreenTransform t = ScreenTransform::fromProjection(proj, canvasW, canvasH);
+        float xa = (0.0f - t.bx)/t.ax, xb = (t.width - t.bx)/t.ax;
+        float ya = (0.0f - t.by)/t.ay, yb = (t.height - t.by)/t.ay;
+        return {std::min(xa,xb), std::min(ya,yb), std::max(xa,xb), std::max(ya,yb)};
+    }
+    glm::vec2 screenToWorld(float px, float py) const {
+        ScreenTransform t = ScreenTransform::fromProjection(proj, canvasW, canvasH);
+        return glm::vec2((px - t.bx)/t.ax, (py - t.by)/t.ay);
+    }
+    // Items touching q, in index order per category (so draw order is preserved).
+    void collectItems(const ItemBounds &q, std::vector<uint32_t> (&out)[CAT_COUNT]){
+        for(auto &v: out) v.clear();
+        index.query(q, [&](ItemRef r, const ItemBounds &){ out[r.cat].push_back(r.index); });
+        for(auto &v: out) std::sort(v.begin(), v.end());
+    }
+    // Fills visibleItems with the items near the view.
+    void cullToView(){
+        // Margin covers overlay geometry drawn just outside item bounds (dimension lines).
+        collectItems(viewBounds().expanded(20.0f), visibleItems);
+    }
+
+    bool fineDetail() const { return scaleX >= LOD_FINE_DETAIL_SCALE; }
+    static bool isChair(const RectView &r){ return r.label == "Chair"; }
+    static bool isSofa(const RectView &r){ return r.label == "Sofa"; }
+
+    // ---------------------- Camera control ----------------------
+    void panBy(float dxPx, float dyPx){
+        camera.cx -= dxPx / scaleX;
+        camera.cy -= dyPx / scaleY;
+        updateProjection(canvasW, canvasH);
+    }
+    // Zooms by `factor`, keeping the world point under (px,py) fixed on screen.
+    void zoomAt(float px, float py, float factor){
+        glm::vec2 before = screenToWorld(px, py);
+        camera.zoom = glm::clamp(camera.zoom * factor, Camera::kMinZoom, Camera::kMaxZoom);
+        updateProjection(canvasW, canvasH);
+        glm::vec2 after = screenToWorld(px, py);
+        camera.cx += before.x - after.x;
+        camera.cy += before.y - after.y;
+        updateProjection(canvasW, canvasH);
+    }
+    void zoomToFit(){
+        camera = Camera();
+        updateProjection(canvasW, canvasH);
+    }
+    // ---------------------- Additional compliance features ----------------------
+    void loadTextures() {
+    static const char* const paths[TEX_LAYER_COUNT] = {
+        "floor.jpg",                // TEX_FLOOR
+        "wall.jpg",                 // TEX_WALL
+        "/home/floor.jpg",          // TEX_KITCHEN
+        "/home/textures/bar.jpg",   // TEX_BAR
+        "textures/table.jpg",       // TEX_TABLE
+        "textures/door.jpg",        // TEX_DOOR
+    };
+    gSceneTextures.load(paths); // decodes in the background; see pollTextures()
+    }
+
+    // ---------------------- Overlays ----------------------
+    // drawDoorSwings/drawFloorDrains/drawDimensions/drawScaleBar/drawLabels only queue
+    // their anchors and items into `overlay`; drawOverlays() projects every anchor in one
+    // batch and then draws the visible items in queue order.
+
+    // Queues the overlays of the current view into `pass`, in draw order.
+    void queueOverlays(OverlayPass &pass) {
+        pass.begin(ScreenTransform::fromProjection(proj, canvasW, canvasH), scaleX);
+        { ProfileScope p(gProfiler, "cull"); cullToView(); }
+        { ProfileScope p(gProfiler, "drawDoorSwings"); drawDoorSwings(pass); }
+        { ProfileScope p(gProfiler, "drawFloorDrains"); drawFloorDrains(pass); }
+        { ProfileScope p(gProfiler, "drawDimensions"); drawDimensions(pass); } // dynamic & scaled
+        { ProfileScope p(gProfiler, "drawScaleBar"); drawScaleBar(pass); }
+        { ProfileScope p(gProfiler, "drawLabels"); drawLabels(pass); }
+    }
+    void drawOverlays(ImDrawList* target = nullptr) {
+        queueOverlays(overlay);
+        { ProfileScope p(gProfiler, "overlay.project"); overlay.project(); }
+        { ProfileScope p(gProfiler, "overlay.flush"); overlay.flush(target ? target : ImGui::GetForegroundDrawList()); }
+        drawEgress(target ? target : ImGui::GetForegroundDrawList());
+        drawSelection(target ? target : ImGui::GetForegroundDrawList());
+    }
+
+    void drawDoorSwings(OverlayPass &ov) {
+    if (!showDoorSwings || builtAnalytic) return; // the analytic path draws them in render()
+    for (uint32_t i : visibleItems[CAT_DOOR]) {
+        const auto &d = doors[i];
+        ov.add(OV_DOOR_SWING, (d.w + d.h) * 0.5f, IM_COL32(255,128,0,200), nullptr, d.x, d.y);
+    }
+    }
+
+    void drawDimensions(OverlayPass &ov) {
+    if(!showDimensions) return;
+
+    auto drawRectDims = [&](const RectStore &items, uint8_t cat){
+        for(uint32_t i: visibleItems[cat]){
+            const auto &r = items[i];
+            ov.add(OV_DIMENSION_H, r.w, IM_COL32(0,0,0,255), nullptr, r.x, r.y+r.h+5, r.x+r.w, r.y+r.h+5).dim = &r.dimLayout[0];
+            ov.add(OV_DIMENSION_V, r.h, IM_COL32(0,0,0,255), nullptr, r.x+r.w+5, r.y, r.x+r.w+5, r.y+r.h).dim = &r.dimLayout[1];
+        }
+    };
+
+    // Draw dimensions for all relevant rects
+    drawRectDims(walls, CAT_WALL);
+    //drawRectDims(kitchen, CAT_KITCHEN);
+    drawRectDims(bar, CAT_BAR);
+    drawRectDims(windows, CAT_WINDOW);
+    //drawRectDims(restrooms, CAT_RESTROOM);
+    //drawRectDims(fire, CAT_FIRE);
+    //drawRectDims(tablesRect, CAT_TABLE_RECT);
+    }
+
+    void drawFloorDrains(OverlayPass &ov) {
+    if (!showDrains || !fineDetail()) return;
+    for (uint32_t i : visibleItems[CAT_DRAIN]) {
+        const auto &d = drains[i];
+        ov.add(OV_DRAIN, d.r, IM_COL32(d.rgba & 0xFF, (d.rgba>>8) & 0xFF, (d.rgba>>16) & 0xFF, 255),
+                    d.label.empty() ? nullptr : d.label.c_str(), d.x, d.y).layout = &d.markerLayout;
+    }
+    }
+
+    void drawScaleBar(OverlayPass &ov) {
+    // Example: scale bar starts at world coordinates (60, 40)
+    float wx0 = 60.0f;
+    float wy0 = 40.0f;
+    float length_m = 100.0f; // 1 meter in world units
+    ov.add(OV_SCALE_BAR, length_m, IM_COL32(0,0,0,255), "1 m", wx0, wy0, wx0 + length_m, wy0);
+    }
+
+    void drawLabels(OverlayPass &ov) {
+    if(!showLabels) return;
+
+    auto queue = [&](const std::string &label, float x, float y, TextLayout &layout, uint8_t priority){
+        OverlayItem &it = ov.add(OV_LABEL, 0.0f, IM_COL32(0,0,0,255), label.c_str(), x, y);
+        it.layout = &layout; it.priority = priority;
+    };
+    auto drawRectLabels = [&](auto const &items, uint8_t cat, uint8_t priority){
+        for (uint32_t i : visibleItems[cat]) {
+            const auto &r = items[i];
+            if (r.label.empty()) continue;
+            queue(r.label, r.x + r.w*0.5f, r.y + r.h*0.5f, r.labelLayout, priority);
+        }
+    };
+    auto drawCircleLabels = [&](const CircleStore &items, uint8_t cat, uint8_t priority){
+        for(uint32_t i: visibleItems[cat]){
+            const auto &c = items[i];
+            if(c.label.empty()) continue;
+            queue(c.label, c.x, c.y, c.labelLayout, priority);
+        }
+    };
+
+    drawRectLabels(walls, CAT_WALL, LP_WALL);
+    drawRectLabels(kitchen, CAT_KITCHEN, LP_ROOM);
+    drawRectLabels(bar, CAT_BAR, LP_ROOM);
+    drawRectLabels(windows, CAT_WINDOW, LP_FIXTURE);
+    drawRectLabels(restrooms, CAT_RESTROOM, LP_ROOM);
+    drawRectLabels(fire, CAT_FIRE, LP_SAFETY);
+    for (uint32_t i : visibleItems[CAT_TABLE_RECT]) {
+        const auto &t = tablesRect[i];
+        if (t.label.empty() || (isChair(t) && !fineDetail())) continue;
+        queue(t.label, t.x + t.w*0.5f, t.y + t.h*0.5f, t.labelLayout, t.label=="Chair" ? LP_CHAIR : LP_FURNITURE);
+    }
+    drawCircleLabels(tablesCircle, CAT_TABLE_CIRCLE, LP_FURNITURE);
+    drawRectLabels(doors, CAT_DOOR, LP_EXIT);
+    drawCircleLabels(drains, CAT_DRAIN, LP_FIXTURE);
+    }
+
+void drawDoorSwingElevation(float x, float y, float w, float h, bool isFront=true) {
+    ImDrawList* draw_list = ImGui::GetForegroundDrawList();
+    float sx = scaleX, sy = scaleY;
+    float groundY = 600.0f;
+
+    ImVec2 center(x*sx, groundY - h*sy);
+    float radius = w * 0.5f * sx;
+    int stride = CIRCLE_TABLE_SIZE / circleSegments(radius);
+    const int quarter = CIRCLE_TABLE_SIZE / 4;
+
+    for(int i=0; i<quarter; i+=stride) {
+        ImVec2 p0 = ImVec2(center.x + radius*kUnitCircle.c[i], center.y + radius*kUnitCircle.s[i]);
+        ImVec2 p1 = ImVec2(center.x + radius*kUnitCircle.c[i+stride], center.y + radius*kUnitCircle.s[i+stride]);
+        draw_list->AddLine(p0,p1, IM_COL32(0,0,0,255), 1.0f);
+    }
+}
+
+// Front: seen from the plan's top edge (y = 0), u = x and near faces have small y.
+// Side: seen from the left edge (x = 0), u = y and near faces have small x.
+void buildElevation(ElevationView &ev, bool front){
+    ev.begin();
+    const uint32_t windowColor = packColor(120/255.0f, 180/255.0f, 1.0f, 1.0f);
+    const uint32_t doorFill = packColor(180/255.0f, 100/255.0f, 50/255.0f, 1.0f);
+    auto face = [&](float x, float y, float w, float h, float v0, float height, uint32_t rgba, uint8_t rank){
+        if(front) ev.add(x, v0, w, height, rgba, y, rank);
+        else ev.add(y, v0, h, height, rgba, x, rank);
+    };
+    for(auto w: walls) face(w.x, w.y, w.w, w.h, 0.0f, wallHeight, w.rgba, 0);
+    if(showWindows) for(auto win: windows) face(win.x, win.y, win.w, win.h, windowSill, windowHeight, windowColor, 1);
+    if(showDoors) for(auto d: doors) face(d.x, d.y, d.w, d.h, 0.0f, doorHeight, doorFill, 2);
+}
+void drawElevation(ElevationView &ev, bool front, const char* title, SceneShaders &sh){
+    // The cached texture is keyed on the layout and on what buildElevation() includes.
+    const uint8_t shown = (uint8_t)(showWindows | showDoors << 1);
+    if(ev.builtRevision != layoutRevision || ev.builtShown != shown){
+        buildElevation(ev, front);
+        ev.render(sh);
+        ev.builtRevision = layoutRevision;
+        ev.builtShown = shown;
+    }
+    ImGui::SetNextWindowSize(ImVec2(620, 340), ImGuiCond_FirstUseEver);
+    if(ImGui::Begin(title)) ev.show();
+    ImGui::End();
+}
+void drawFrontElevationView(SceneShaders &sh) {
+    if (!showFrontElevation) return;
+    drawElevation(frontElevation, true, "Front Elevation", sh);
+}
+void drawSideElevationView(SceneShaders &sh) {
+    if (!showSideElevation) return;
+    drawElevation(sideElevation, false, "Side Elevation", sh);
+}
+void updateProjection(int w,int h){
+        canvasW = w;
+        canvasH = h;
+        glViewport(0, 0, w, h);
+
+        float fit = std::min((float)w / 1200.0f, (float)h / 800.0f);
+        scaleX = scaleY = fit * camera.zoom;
+
+        // World -> camera (centre at origin) -> pixels -> clip. Geometry is stored in
+        // world units, so a resize or pan only changes this matrix.
+        proj = glm::ortho(0.0f, (float)w, (float)h, 0.0f, -1.0f, 1.0f)
+             * glm::translate(glm::mat4(1.0f), glm::vec3(w*0.5f, h*0.5f, 0.0f))
+             * glm::scale(glm::mat4(1.0f), glm::vec3(scaleX, scaleY, 1.0f))
+             * glm::translate(glm::mat4(1.0f), glm::vec3(-camera.cx, -camera.cy, 0.0f));
+        if(geometryPinned) return; // the pinned build covers every view until unpinned
+        // Circle segment counts depend on on-screen size; re-pick them once the scale
+        // has drifted far enough to cross a LOD step. Analytic circles have no segments.
+        if(builtLodScale > 0.0f && !builtAnalytic && (scaleX > builtLodScale*1.41f || scaleX < builtLodScale*0.71f))
+            markGeometryDirty();
+        if(fineDetail() != builtFineDetail || !builtRegion.contains(viewBounds()))
+            markGeometryDirty();
+    }
+
+// ---------------------- Static geometry ----------------------
+// Per-category draw style, shared by the full build and the per-item patches.
+RectSpan spanOf(uint8_t cat) const {
+    if(auto* r = rectCategory(cat)) return r->span();
+    return {doors.x.data(), doors.y.data(), doors.w.data(), doors.h.data(), nullptr};
+}
+static uint32_t doorColor(){ return packColor(glm::vec4(0.545f,0.271f,0.075f,1.0f)); }
+// Fill of a rect category on the non-instanced path (floor and walls are textured quads).
+static void fillStyle(uint8_t cat, RectEmit &kind, bool &itemColor, uint32_t &color){
+    kind = (cat==CAT_FLOOR || cat==CAT_WALL) ? RECT_TEXTURED : RECT_FILL;
+    itemColor = cat!=CAT_FLOOR && cat!=CAT_WALL && cat!=CAT_DOOR;
+    color = cat==CAT_DOOR ? doorColor() : packColor(glm::vec4(1.0f));
+}
+// Outline colour of the categories drawn in the line pass; 0 for none.
+static uint32_t outlineColorOf(uint8_t cat){
+    switch(cat){
+    case CAT_WALL:       return packColor(glm::vec4(0.2f,0.24f,0.28f,1.0f));
+    case CAT_KITCHEN:    return packColor(glm::vec4(0.12f,0.12f,0.12f,1.0f));
+    case CAT_TABLE_RECT: return packColor(glm::vec4(0.62f,0.36f,0.12f,1.0f));
+    default:             return 0;
+    }
+}
+// Texture layers ride along per instance, so textured and flat items share a draw.
+int32_t instanceLayer(uint8_t cat, uint32_t i) const {
+    const TextureArray &tx = gSceneTextures;
+    switch(cat){
+    case CAT_FLOOR:        return tx.layer(TEX_FLOOR);
+    case CAT_WALL:         return tx.layer(TEX_WALL);
+    case CAT_KITCHEN:      return tx.layer(TEX_KITCHEN);
+    case CAT_BAR:          return tx.layer(TEX_BAR);
+    case CAT_DOOR:         return tx.layer(TEX_DOOR);
+    case CAT_TABLE_RECT:   return tablesRect[i].label.find("Table") != std::string::npos ? tx.layer(TEX_TABLE) : -1;
+    case CAT_TABLE_CIRCLE: return tablesCircle[i].label.find("Table") != std::string::npos ? tx.layer(TEX_TABLE) : -1;
+    default:               return -1;
+    }
+}
+uint32_t instanceColor(uint8_t cat, uint32_t i) const {
+    if(cat==CAT_FLOOR || cat==CAT_WALL) return packColor(glm::vec4(1.0f));
+    if(cat==CAT_DOOR) return doorColor();
+    if(auto* c = circleCategory(cat)) return c->rgba[i];
+    return rectCategory(cat)->rgba[i];
+}
+// Zoomed out, tables lose their chairs, and sofas lose their outline too.
+bool shownAtDetail(uint8_t cat, uint32_t i, bool fine, bool outline) const {
+    if(fine || cat!=CAT_TABLE_RECT) return true;
+    RectView t = tablesRect[i];
+    return !isChair(t) && !(outline && isSofa(t));
+}
+
+// Tessellates one chunk into its own buffers. Runs on any thread: reads the stores and
+// writes only the chunk and its items' slots, which are chunk-local until rebased.
+void buildChunk(GeometryChunk &ch, bool instanced, bool fine, bool analytic){
+    const uint8_t c = ch.cat;
+    const uint32_t* ids = builtItems[c].data() + ch.first;
+    ch.tri.begin(); ch.line.begin(); ch.rects.begin(); ch.outlines.begin(); ch.swings.begin();
+    for(auto &ci: ch.circles) ci.begin();
+    auto &shown = ch.shown; // items that survive the LOD filter
+    if(instanced){
+        for(uint32_t k=0;k<ch.count;k++){
+            uint32_t i = ids[k];
+            if(!shownAtDetail(c, i, fine, false)) continue;
+            if(c==CAT_TABLE_CIRCLE){
+                float r = tablesCircle.r[i];
+                int lod = analytic ? 0 : circleLodLevel(r*builtLodScale);
+                fillSlot[c][i] = encodeSlot(lod, ch.circles[lod].data.size());
+                ch.circles[lod].push(tablesCircle.x[i], tablesCircle.y[i], r, r, instanceColor(c,i), instanceLayer(c,i));
+            } else {
+                RectSpan sp = spanOf(c);
+                fillSlot[c][i] = (int32_t)ch.rects.data.size();
+                ch.rects.push(sp.x[i], sp.y[i], sp.w[i], sp.h[i], instanceColor(c,i), instanceLayer(c,i));
+            }
+        }
+    } else if(c==CAT_TABLE_CIRCLE){
+        for(uint32_t k=0;k<ch.count;k++){
+            uint32_t i = ids[k];
+            int lod = circleLodLevel(tablesCircle.r[i]*builtLodScale);
+            fillSlot[c][i] = encodeSlot(lod, ch.tri.vertexCount);
+            addCircleTriangles(ch.tri, tablesCircle.x[i], tablesCircle.y[i], tablesCircle.r[i], circleSegmentsForLevel(lod), tablesCircle.rgba[i]);
+        }
+    } else {
+        shown.clear();
+        for(uint32_t k=0;k<ch.count;k++) if(shownAtDetail(c, ids[k], fine, false)) shown.push_back(ids[k]);
+        RectEmit kind; bool itemColor; uint32_t color;
+        fillStyle(c, kind, itemColor, color);
+        for(size_t k=0;k<shown.size();k++) fillSlot[c][shown[k]] = (int32_t)(k*6);
+        addRects(ch.tri, spanOf(c), shown, kind, itemColor, color);
+    }
+    if(c==CAT_WALL || c==CAT_KITCHEN || c==CAT_TABLE_RECT){
+        shown.clear();
+        for(uint32_t k=0;k<ch.count;k++) if(shownAtDetail(c, ids[k], fine, true)) shown.push_back(ids[k]);
+        if(analytic){
+            RectSpan sp = spanOf(c);
+            for(size_t k=0;k<shown.size();k++){
+                uint32_t i = shown[k];
+                lineSlot[c][i] = (int32_t)k;
+                ch.outlines.push(sp.x[i], sp.y[i], sp.w[i], sp.h[i], outlineColorOf(c));
+            }
+        } else {
+            for(size_t k=0;k<shown.size();k++) lineSlot[c][shown[k]] = (int32_t)(k*8);
+            addRects(ch.line, spanOf(c), shown, RECT_OUTLINE, false, outlineColorOf(c));
+        }
+    }
+    if(analytic && c==CAT_DOOR){
+        for(uint32_t k=0;k<ch.count;k++){
+            uint32_t i = ids[k];
+            lineSlot[c][i] = (int32_t)ch.swings.data.size();
+            ch.swings.push(doors.x[i], doors.y[i], swingRadius(i), swingRadius(i), swingColor());
+        }
+    }
+}
+// Door swing wedge: hinge at the door's origin, as drawDoorSwings places it.
+float swingRadius(uint32_t i) const { return (doors.w[i] + doors.h[i]) * 0.5f; }
+static uint32_t swingColor(){ return IM_COL32(255,128,0,200); } // IM_COL32 packs R in the low byte, as packColor does
+// Copies a built chunk to its place in the shared buffers and makes its slots absolute.
+void placeChunk(const GeometryChunk &ch, bool instanced, bool analytic){
+    const uint8_t c = ch.cat;
+    if(!ch.tri.data.empty()) memcpy(triBuf.data.data()+ch.triBase, ch.tri.data.data(), ch.tri.vertexCount*sizeof(PackedVertex));
+    if(!ch.line.data.empty()) memcpy(lineBuf.data.data()+ch.lineBase, ch.line.data.data(), ch.line.vertexCount*sizeof(PackedVertex));
+    if(!ch.rects.data.empty()) memcpy(rectInst.data.data()+ch.rectBase, ch.rects.data.data(), ch.rects.data.size()*sizeof(ShapeInstance));
+    for(int l=0;l<CIRCLE_LOD_COUNT;l++)
+        if(!ch.circles[l].data.empty())
+            memcpy(circleInst[l].data.data()+ch.circleBase[l], ch.circles[l].data.data(), ch.circles[l].data.size()*sizeof(ShapeInstance));
+    if(!ch.outlines.data.empty()) memcpy(outlineInst.data.data()+ch.outlineBase, ch.outlines.data.data(), ch.outlines.data.size()*sizeof(ShapeInstance));
+    if(!ch.swings.data.empty()) memcpy(swingInst.data.data()+ch.swingBase, ch.swings.data.data(), ch.swings.data.size()*sizeof(ShapeInstance));
+    const size_t lineBase = !analytic ? ch.lineBase : (c==CAT_DOOR ? ch.swingBase : ch.outlineBase);
+    const uint32_t* ids = builtItems[c].data() + ch.first;
+    for(uint32_t k=0;k<ch.count;k++){
+        int32_t &fs = fillSlot[c][ids[k]], &ls = lineSlot[c][ids[k]];
+        if(fs != SLOT_NONE){
+            if(c==CAT_TABLE_CIRCLE){
+                int lod = slotLod(fs);
+                fs = encodeSlot(lod, slotIndex(fs) + (instanced ? ch.circleBase[lod] : ch.triBase));
+            }
+            else fs += (int32_t)(instanced ? ch.rectBase : ch.triBase);
+        }
+        if(ls != SLOT_NONE) ls += (int32_t)lineBase;
+    }
+}
+
+// Rebuilds triBuf/lineBuf (or the instance buffers) for the items in the view plus
+// slack and uploads them once. Vertices stay in world units; the view lives in proj.
+// Every item's slot is recorded so an edit can later rewrite just that item.
+// Each category's items are split into chunks tessellated in parallel on gJobs; the
+// chunks are then laid out in category order (the serial draw order) and copied in
+// parallel, so this thread only sums chunk sizes and uploads.
+void buildStaticGeometry() {
+    triBuf.begin();
+    rectInst.begin();
+    for(auto &ci: circleInst) ci.begin();
+    outlineInst.begin(); swingInst.begin(); gridInst.begin();
+    builtInstanced = useInstancing;
+    builtAnalytic = useInstancing && useAnalyticShapes;
+    builtLodScale = geometryPinned ? pinnedScale : scaleX;
+    builtFineDetail = builtLodScale >= LOD_FINE_DETAIL_SCALE;
+    // Build for the view plus half a view of slack on each side (or the pinned region).
+    ItemBounds v = viewBounds();
+    builtRegion = geometryPinned ? pinnedRegion : v.expanded(std::max(v.x1 - v.x0, v.y1 - v.y0) * 0.5f);
+    collectItems(builtRegion, builtItems);
+    const bool fine = builtFineDetail, instanced = builtInstanced, analytic = builtAnalytic;
+    for(uint8_t c=0;c<CAT_COUNT;c++){
+        fillSlot[c].assign(categorySize(c), SLOT_NONE);
+        lineSlot[c].assign(categorySize(c), SLOT_NONE);
+    }
+
+    // Chunks follow draw order: rect-like categories, then round tables. Drains are
+    // overlay markers only.
+    size_t chunkCount = 0;
+    for(uint8_t c=0;c<=CAT_TABLE_CIRCLE;c++){
+        for(uint32_t first=0; first<builtItems[c].size(); first+=GEOMETRY_CHUNK_ITEMS){
+            if(chunkCount == geometryChunks.size()) geometryChunks.emplace_back();
+            GeometryChunk &ch = geometryChunks[chunkCount++];
+            ch.cat = c; ch.first = first;
+            ch.count = std::min<uint32_t>(GEOMETRY_CHUNK_ITEMS, (uint32_t)builtItems[c].size() - first);
+        }
+    }
+    gJobs.parallelFor((uint32_t)chunkCount, [&](uint32_t k){ buildChunk(geometryChunks[k], instanced, fine, analytic); });
+
+    // ------------------ LINES ------------------
+    lineBuf.begin();
+    // Grid (always built; showGrid only decides whether this range is drawn)
+    glm::vec4 gcol(0.0f,0.0f,0.0f,0.06f);
+    int step = 50;
+    for(int x=50;x<=1150;x+=step) lineBuf.pushVertex(x,50,gcol.r,gcol.g,gcol.b,gcol.a), lineBuf.pushVertex(x,750,gcol.r,gcol.g,gcol.b,gcol.a);
+    for(int y=50;y<=750;y+=step) lineBuf.pushVertex(50,y,gcol.r,gcol.g,gcol.b,gcol.a), lineBuf.pushVertex(1150,y,gcol.r,gcol.g,gcol.b,gcol.a);
+    gridVertexCount = lineBuf.vertexCount;
+    gridInst.push(50.0f, 50.0f, 1100.0f, 700.0f, gcol); // the same lines, for the analytic path
+
+    size_t tri = 0, line = gridVertexCount, rects = 0, circles[CIRCLE_LOD_COUNT] = {}, outlines = 0, swings = 0;
+    for(size_t k=0;k<chunkCount;k++){
+        GeometryChunk &ch = geometryChunks[k];
+        ch.triBase = tri; tri += ch.tri.vertexCount;
+        ch.lineBase = line; line += ch.line.vertexCount;
+        ch.rectBase = rects; rects += ch.rects.data.size();
+        for(int l=0;l<CIRCLE_LOD_COUNT;l++){ ch.circleBase[l] = circles[l]; circles[l] += ch.circles[l].data.size(); }
+        ch.outlineBase = outlines; outlines += ch.outlines.data.size();
+        ch.swingBase = swings; swings += ch.swings.data.size();
+    }
+    triBuf.allocVertices(tri);
+    lineBuf.allocVertices(line - gridVertexCount);
+    rectInst.data.resize(rects);
+    for(int l=0;l<CIRCLE_LOD_COUNT;l++) circleInst[l].data.resize(circles[l]);
+    outlineInst.data.resize(outlines); swingInst.data.resize(swings);
+    gJobs.parallelFor((uint32_t)chunkCount, [&](uint32_t k){ placeChunk(geometryChunks[k], instanced, analytic); });
+
+    // Fills go to the instance buffers or to triBuf; the analytic path (always
+    // instanced) adds outline, swing and grid quads. lineBuf always holds the grid lines.
+    if(analytic){
+        rectInst.upload();
+        for(auto &ci: circleInst) ci.upload();
+        outlineInst.upload(); swingInst.upload(); gridInst.upload();
+    } else if(instanced){
+        rectInst.upload();
+        for(auto &ci: circleInst) ci.upload();
+    } else {
+        triBuf.upload();
+    }
+    lineBuf.upload();
+    geometryDirty = false;
+}
+
+// Rewrites one edited item in place (instance or vertices, plus its outline) and marks
+// that range for glBufferSubData in render(). Falls back to a full rebuild when the
+// item's slot layout would change: it left the built region, was not built, or its
+// circle LOD changed.
+void patchItemGeometry(ItemRef r){
+    if(geometryDirty) return; // a full rebuild is coming anyway
+    const uint8_t c = r.cat;
+    const uint32_t i = r.index;
+    if(c==CAT_DRAIN) return;  // not part of the static geometry
+    if(i >= fillSlot[c].size() || !builtRegion.contains(itemBounds(r))){ markGeometryDirty(); return; }
+    int32_t fs = fillSlot[c][i];
+    if(fs == SLOT_NONE){
+        if(shownAtDetail(c, i, builtFineDetail, false)) markGeometryDirty(); // newly in range
+        return;
+    }
+    if(c==CAT_TABLE_CIRCLE){
+        float cx = tablesCircle.x[i], cy = tablesCircle.y[i], cr = tablesCircle.r[i];
+        int lod = builtAnalytic ? 0 : circleLodLevel(cr*builtLodScale);
+        if(lod != slotLod(fs)){ markGeometryDirty(); return; }
+        uint32_t at = slotIndex(fs);
+        if(builtInstanced){
+            ShapeInstance &in = circleInst[lod].data[at];
+            in.x = cx; in.y = cy; in.w = in.h = cr;
+            circleInst[lod].markDirty(at, 1);
+        } else {
+            int segs = circleSegmentsForLevel(lod);
+            emitCircle(triBuf.data.data()+at, cx, cy, cr, segs, tablesCircle.rgba[i]);
+            triBuf.markDirty(at, (size_t)segs*3);
+        }
+        return;
+    }
+    RectSpan sp = spanOf(c);
+    if(builtInstanced){
+        ShapeInstance &in = rectInst.data[fs];
+        in.x = sp.x[i]; in.y = sp.y[i]; in.w = sp.w[i]; in.h = sp.h[i];
+        rectInst.markDirty(fs, 1);
+    } else {
+        RectEmit kind; bool itemColor; uint32_t color;
+        fillStyle(c, kind, itemColor, color);
+        emitRects(triBuf.data.data()+fs, sp, &i, 1, kind, itemColor, color);
+        triBuf.markDirty(fs, 6);
+    }
+    int32_t ls = lineSlot[c][i];
+    if(ls == SLOT_NONE) return;
+    if(builtAnalytic){
+        InstanceBuffer &buf = c==CAT_DOOR ? swingInst : outlineInst;
+        ShapeInstance &in = buf.data[ls];
+        if(c==CAT_DOOR){ in.x = doors.x[i]; in.y = doors.y[i]; in.w = in.h = swingRadius(i); }
+        else { in.x = sp.x[i]; in.y = sp.y[i]; in.w = sp.w[i]; in.h = sp.h[i]; }
+        buf.markDirty(ls, 1);
+    } else {
+        emitRects(lineBuf.data.data()+ls, sp, &i, 1, RECT_OUTLINE, false, outlineColorOf(c));
+        lineBuf.markDirty(ls, 8);
+    }
+}
+
+// A texture layer arrived: rewrite the layer of every built instance that changed.
+// Only instances carry layers; the flat path's geometry does not depend on them.
+void refreshInstanceLayers(){
+    if(geometryDirty || !builtInstanced) return;
+    for(uint8_t c=0;c<CAT_COUNT;c++){
+        for(uint32_t i: builtItems[c]){
+            int32_t fs = i < fillSlot[c].size() ? fillSlot[c][i] : SLOT_NONE;
+            if(fs == SLOT_NONE) continue;
+            InstanceBuffer &buf = c==CAT_TABLE_CIRCLE ? circleInst[slotLod(fs)] : rectInst;
+            uint32_t at = c==CAT_TABLE_CIRCLE ? slotIndex(fs) : (uint32_t)fs;
+            int32_t layer = instanceLayer(c, i);
+            if(buf.data[at].layer == layer) continue;
+            buf.data[at].layer = layer;
+            buf.markDirty(at, 1);
+        }
+    }
+}
+
+void render(SceneShaders &sh) {
+    if(useInstancing != builtInstanced || (useInstancing && useAnalyticShapes) != builtAnalytic) geometryDirty = true;
+    if(geometryDirty) buildStaticGeometry();
+    // Edits since the last frame: only the patched ranges go to the GPU.
+    triBuf.flushDirty(); lineBuf.flushDirty();
+    rectInst.flushDirty();
+    for(auto &ci: circleInst) ci.flushDirty();
+    outlineInst.flushDirty(); swingInst.flushDirty();
+
+    if(useInstancing){
+        sh.inst.use();
+        sh.inst.setMat4(sh.instMVP, proj);
+        gGLState.bindTexture(GL_TEXTURE_2D_ARRAY, gSceneTextures.tex, 0);
+        sh.inst.setInt(sh.instTextures, 0);
+        rectInst.draw(sh.inst, sh.instCentered);
+        if(!builtAnalytic) for(auto &ci: circleInst) ci.draw(sh.inst, sh.instCentered);
+    }
+    if(builtAnalytic){ renderAnalytic(sh); return; }
+
+    sh.flat.use();
+    sh.flat.setMat4(sh.flatMVP, proj);
+    // The non-instanced fallback and the line pass are untextured; textures are sampled
+    // per instance from gSceneTextures on the instanced path.
+    sh.flat.setInt(sh.flatUseTexture, false);
+    sh.flat.setInt(sh.flatTexture, 0);
+
+    triBuf.draw(GL_TRIANGLES);
+    lineBuf.draw(GL_LINES, (showGrid && scaleX >= LOD_GRID_SCALE) ? 0 : gridVertexCount);
+}
+// Round tables, grid, outlines and door swings as SDF quads, in the order the line
+// pass and overlays drew them. Widths are in pixels, so they hold at every zoom.
+void renderAnalytic(SceneShaders &sh){
+    enum { SHAPE_CIRCLE, SHAPE_RECT_OUTLINE, SHAPE_SWING, SHAPE_GRID };
+    const GLint quad = unitMeshes.quadFirst, quadCount = unitMeshes.quadCount;
+    sh.sdf.use();
+    sh.sdf.setMat4(sh.sdfMVP, proj);
+    sh.sdf.setFloat(sh.sdfPixel, 1.0f / scaleX);
+    sh.sdf.setFloat(sh.sdfRadius, 0.0f);
+    sh.sdf.setFloat(sh.sdfGridStep, 50.0f);
+    gGLState.bindTexture(GL_TEXTURE_2D_ARRAY, gSceneTextures.tex, 0);
+    sh.sdf.setInt(sh.sdfTextures, 0);
+
+    sh.sdf.setInt(sh.sdfShape, SHAPE_CIRCLE);
+    sh.sdf.setFloat(sh.sdfLineWidth, 0.0f);
+    circleInst[0].drawMesh(sh.sdf, sh.sdfCentered, quad, quadCount);
+    sh.sdf.setFloat(sh.sdfLineWidth, 1.0f);
+    if(showGrid && scaleX >= LOD_GRID_SCALE){
+        sh.sdf.setInt(sh.sdfShape, SHAPE_GRID);
+        gridInst.drawMesh(sh.sdf, sh.sdfCentered, quad, quadCount);
+    }
+    sh.sdf.setInt(sh.sdfShape, SHAPE_RECT_OUTLINE);
+    outlineInst.drawMesh(sh.sdf, sh.sdfCentered, quad, quadCount);
+    if(showDoorSwings){
+        sh.sdf.setInt(sh.sdfShape, SHAPE_SWING);
+        sh.sdf.setFloat(sh.sdfLineWidth, 2.0f * scaleX); // drawDoorSwings' 2 world units
+        swingInst.drawMesh(sh.sdf, sh.sdfCentered, quad, quadCount);
+    }
+}
+
+
+    void destroy(){
+        triBuf.destroy(); lineBuf.destroy();
+        frontElevation.destroy(); sideElevation.destroy();
+        rectInst.destroy(); unitMeshes.destroy();
+        for(auto &ci: circleInst) ci.destroy();
+        outlineInst.destroy(); swingInst.destroy(); gridInst.destroy();
+    }
+};
+
+
+// ---------------------- Scene manager ----------------------
+// Holds every floor of a venue. Layouts load on gWorkers (mmap or JSON parse plus the
+// spatial index); the GL thread then creates the plan's buffers and builds its geometry
+// one frame before it is shown, so switching floors never tessellates on the switch
+// frame. Resident floors beyond the budget are evicted least-recently-used first.
+// All floors share gSceneTextures: they use the same material set.
+struct SceneManager {
+    struct PendingLoad {
+        std::atomic<bool> done{false};
+        bool ok = false;
+        std::unique_ptr<FloorPlan> plan;
+    };
+    struct Floor {
+        std::string name, path;               // empty path: built-in default layout
+        std::unique_ptr<FloorPlan> plan;      // resident: GL objects created
+        std::shared_ptr<PendingLoad> pending; // background load in flight
+        uint64_t lastUsed = 0;
+        bool failed = false;
+        SeatTotals seats; // last known capacity, kept after eviction
+        bool counted = false;
+    };
+    std::vector<Floor> floors;
+    int activeIndex = -1; // floor being drawn
+    int requested = -1;   // floor picked in the UI; becomes active once resident
+    uint64_t clock = 0;
+    size_t budgetBytes = 96u<<20;
+    int canvasW = 1200, canvasH = 800;
+
+    void add(const std::string &name, const std::string &path){ floors.push_back({name, path, nullptr, nullptr, 0, false, {}, false}); }
+    bool resident(int i) const { return floors[i].plan != nullptr; }
+    FloorPlan &active(){ return *floors[activeIndex].plan; }
+
+    // Starts a background load unless the floor is resident or already loading.
+    void prefetch(int i){
+        if(i < 0 || i >= (int)floors.size()) return;
+        Floor &f = floors[i];
+        if(f.plan || f.pending || f.failed) return;
+        auto job = std::make_shared<PendingLoad>();
+        f.pending = job;
+        std::string path = f.path;
+        gWorkers.submit([job, path]{
+            auto plan = std::make_unique<FloorPlan>();
+            if(path.empty()){ plan->setupDefaultLayout(); job->ok = true; }
+            else job->ok = plan->loadLayout(path);
+            job->plan = std::move(plan);
+            job->done.store(true, std::memory_order_release);
+            gRedraw.request();
+        });
+    }
+    // Blocking variant for startup; falls back to the default layout on failure.
+    void loadNow(int i){
+        Floor &f = floors[i];
+        if(f.plan) return;
+        f.pending.reset();
+        auto plan = std::make_unique<FloorPlan>();
+        if(f.path.empty() || !plan->loadLayout(f.path)) plan->setupDefaultLayout();
+        adopt(f, std::move(plan));
+    }
+    void request(int i){
+        if(i < 0 || i >= (int)floors.size()) return;
+        requested = i;
+        floors[i].failed = false; // picking a floor again retries a failed load
+        prefetch(i);
+        prefetch(i-1); prefetch(i+1); // neighbouring levels are the likely next pick
+    }
+
+    // Per frame on the GL thread: adopt finished loads, switch once the requested
+    // floor is ready, then evict over budget.
+    void update(){
+        bool adopted = false;
+        int adoptedIndex = -1;
+        for(auto &f: floors){
+            if(!f.pending || !f.pending->done.load(std::memory_order_acquire)) continue;
+            // At most one GL init + geometry build per frame; the rest owe another frame,
+            // since their workers' requests may already have been spent.
+            if(adopted){ gRedraw.request(); break; }
+            std::shared_ptr<PendingLoad> job = std::move(f.pending);
+            if(!job->ok){ f.failed = true; std::cerr<<"Scene: could not load floor "<<f.name<<"\n"; continue; }
+            adopt(f, std::move(job->plan));
+            adopted = true;
+            adoptedIndex = (int)(&f - floors.data());
+        }
+        if(requested >= 0 && floors[requested].failed) requested = activeIndex;
+        // A floor adopted this frame has just been tessellated; show it from the next one
+        // so the build and the first draw of the new floor never share a frame.
+        if(adoptedIndex >= 0 && requested == adoptedIndex && activeIndex >= 0) gRedraw.request();
+        else if(requested >= 0 && requested != activeIndex && resident(requested)){
+            activeIndex = requested;
+            active().updateProjection(canvasW, canvasH);
+        }
+        if(activeIndex >= 0) floors[activeIndex].lastUsed = ++clock;
+        for(auto &f: floors) if(f.plan){ f.seats = f.plan->seating.total; f.counted = true; }
+        evict();
+    }
+    // Venue capacity from every floor seen so far, then the active floor's breakdown.
+    void drawSeating(){
+        if(!ImGui::CollapsingHeader("Seating")) return;
+        SeatTotals venue;
+        for(auto &f: floors){
+            if(!f.counted) continue;
+            venue.tables += f.seats.tables; venue.seats += f.seats.seats; venue.loose += f.seats.loose;
+            if(floors.size() > 1) ImGui::Text("%s: %u seats at %u tables", f.name.c_str(), f.seats.seats, f.seats.tables);
+        }
+        ImGui::Text("Venue: %u seats at %u tables", venue.seats, venue.tables);
+        if(activeIndex >= 0) active().drawSeatingDetail();
+    }
+    void adopt(Floor &f, std::unique_ptr<FloorPlan> plan){
+        f.plan = std::move(plan);
+        f.plan->initGL(canvasW, canvasH);
+        f.plan->buildStaticGeometry();
+        f.lastUsed = ++clock;
+    }
+    size_t residentBytes(){
+        size_t total = 0;
+        for(auto &f: floors) if(f.plan) total += f.plan->memoryBytes();
+        return total;
+    }
+    void evict(){
+        size_t total = residentBytes();
+        while(total > budgetBytes){
+            int victim = -1;
+            for(int i=0;i<(int)floors.size();i++){
+                if(!floors[i].plan || i==activeIndex || i==requested) continue;
+                // A running export holds the plan until its next step() cancels it.
+                if(floors[i].plan->geometryPinned) continue;
+                if(victim < 0 || floors[i].lastUsed < floors[victim].lastUsed) victim = i;
+            }
+            if(victim < 0) break;
+            total -= floors[victim].plan->memoryBytes();
+            floors[victim].plan->destroy();
+            floors[victim].plan.reset();
         }
+    }
+    void resize(int w, int h){
+        canvasW = w; canvasH = h;
+        if(activeIndex >= 0) active().updateProjection(w, h);
+    }
+    // Called once per frame on the GL thread to pick up finished texture decodes.
+    void pollTextures(){
+        if(!gSceneTextures.pumpUploads()) return;
+        for(auto &f: floors) if(f.plan) f.plan->refreshInstanceLayers(); // patched in place
+    }
+    void destroy(){
+        for(auto &f: floors) if(f.plan){ f.plan->destroy(); f.plan.reset(); }
+    }
+};
 
-        for(auto &y: rightY){
-            tablesRect.push_back({rightX, y, tableSize, tableSize, glm::vec4(0.902f,0.494f,0.133f,1.0f), "Table"});
-            tablesRect.push_back({rightX - chairW, y + (tableSize-chairH)/2, chairW, chairH, glm::vec4(0.10f,0.54f,0.22f,1.0f), ""});
-            tablesRect.push_back({rightX + tableSize, y + (tableSize-chairH)/2, chairW, chairH, glm::vec4(0.10f,0.54f,0.22f,1.0f), ""});
+// ---------------------- Streaming image writers ----------------------
+// PNG or PDF output written strip by strip, so a large export never holds the whole
+// image. Neither zlib nor an image writer is vendored, so rows go through a small
+// deflate encoder: one fixed-Huffman block whose only matches are byte runs at
+// distance 1, the bulk of a plan render once rows are PNG-filtered.
+static uint32_t crc32Update(uint32_t crc, const uint8_t* p, size_t n){
+    static const auto table = []{
+        std::array<uint32_t,256> t;
+        for(uint32_t i=0;i<256;i++){
+            uint32_t c = i;
+            for(int k=0;k<8;k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
         }
+        return t;
+    }();
+    crc = ~crc;
+    for(size_t i=0;i<n;i++) crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
 
-        // --- Round Tables ---
-        int numRound = 2;
-        float baseX = 550.0f;
-        float baseY = 600.0f;
-        float tableSpacing = 170.0f;
-        float tableRadius = 60.0f;
-        float chairDist = tableRadius + 15.0f;
-        for(int i=0;i<numRound;i++){
-            float tx = baseX + i*tableSpacing;
-            float ty = baseY;
-            tablesCircle.push_back({tx, ty, tableRadius, glm::vec4(0.55f,0.35f,0.2f,1.0f), "Table"});
+struct DeflateWriter {
+    std::vector<uint8_t> out; // compressed bytes not yet taken by the caller
+    uint64_t bitBuf = 0;
+    int bitCount = 0;
+    uint32_t adlerA = 1, adlerB = 0;
+    int prev = -1;   // last byte emitted (the distance-1 match source), -1 before any
+    uint32_t run = 0; // bytes equal to prev not yet emitted
 
-            for(int c=0;c<4;c++){
-                float angle = (float)c/4.0f * 2.0f * M_PI;
-                float cx = tx + cosf(angle)*chairDist;
-                float cy = ty + sinf(angle)*chairDist;
-                tablesRect.push_back({cx-chairW/2, cy-chairH/2, chairW, chairH, glm::vec4(0.10f,0.54f,0.22f,1.0f), "Chair"});
+    void begin(){
+        out.clear(); bitBuf = 0; bitCount = 0; adlerA = 1; adlerB = 0; prev = -1; run = 0;
+        out.push_back(0x78); out.push_back(0x01); // zlib header: deflate, 32K window, fastest
+        putBits(0, 1); putBits(1, 2);             // BFINAL=0, BTYPE=01 (fixed Huffman)
+    }
+    void putBits(uint32_t bits, int n){
+        bitBuf |= (uint64_t)bits << bitCount; bitCount += n;
+        while(bitCount >= 8){ out.push_back((uint8_t)bitBuf); bitBuf >>= 8; bitCount -= 8; }
+    }
+    // Huffman codes go out most significant bit first.
+    void putCode(uint32_t code, int n){
+        uint32_t r = 0;
+        for(int i=0;i<n;i++) r |= ((code >> i) & 1) << (n-1-i);
+        putBits(r, n);
+    }
+    void putSymbol(int sym){
+        if(sym < 144) putCode(0x30 + sym, 8);
+        else if(sym < 256) putCode(0x190 + sym - 144, 9);
+        else if(sym < 280) putCode(sym - 256, 7);
+        else putCode(0xC0 + sym - 280, 8);
+    }
+    void putMatch(uint32_t len){ // len in 3..258, distance 1
+        static const uint16_t base[29] = {3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258};
+        static const uint8_t extra[29] = {0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0};
+        int code = 28;
+        while(base[code] > len) code--;
+        putSymbol(257 + code);
+        putBits(len - base[code], extra[code]);
+        putCode(0, 5); // distance code 0: distance 1
+    }
+    void flushRun(){
+        if(run >= 3) putMatch(run);
+        else for(uint32_t i=0;i<run;i++) putSymbol(prev);
+        run = 0;
+    }
+    void write(const uint8_t* p, size_t n){
+        for(size_t i=0;i<n;i++){
+            adlerA = (adlerA + p[i]) % 65521u; adlerB = (adlerB + adlerA) % 65521u;
+            if(p[i] == prev){
+                if(run == 258) flushRun();
+                run++;
+            } else {
+                flushRun();
+                putSymbol(p[i]);
+                prev = p[i];
             }
         }
+    }
+    // Ends the data block, appends an empty final block and the Adler-32 trailer.
+    void finish(){
+        flushRun();
+        putSymbol(256);
+        putBits(1, 1); putBits(1, 2); putSymbol(256);
+        if(bitCount) putBits(0, 8 - bitCount);
+        uint32_t adler = (adlerB << 16) | adlerA;
+        for(int s=24;s>=0;s-=8) out.push_back((uint8_t)(adler >> s));
+    }
+};
 
-        // --- Sofa Area ---
-        tablesRect.push_back({965, 710, 140, 40, glm::vec4(0.32f,0.20f,0.10f,1.0f), "Sofa"});
-        tablesRect.push_back({970, 715, 60, 30, glm::vec4(0.45f,0.30f,0.18f,1.0f), ""});
-        tablesRect.push_back({1040, 715, 60, 30, glm::vec4(0.45f,0.30f,0.18f,1.0f), ""});
-        tablesRect.push_back({1100, 550, 40, 150, glm::vec4(0.32f,0.20f,0.10f,1.0f), "Sofa"});
-        tablesRect.push_back({1105, 555, 30, 60, glm::vec4(0.45f,0.30f,0.18f,1.0f), ""});
-        tablesRect.push_back({1105, 635, 30, 60, glm::vec4(0.45f,0.30f,0.18f,1.0f), ""});
-        tablesRect.push_back({1000, 580, 80, 100, glm::vec4(0.6f,0.4f,0.2f,1.0f), "Coffee Table"});
+// Writes an RGB8 image top row first. PNG puts each strip's compressed bytes in one IDAT
+// chunk; PDF embeds the same zlib stream as a FlateDecode image whose PNG predictor
+// undoes the row filters. Not thread-safe: one thread drives a writer at a time.
+struct StreamingImageWriter {
+    enum Format { FORMAT_PNG, FORMAT_PDF };
+    Format format = FORMAT_PNG;
+    std::string path;
+    FILE* f = nullptr;
+    int width = 0, height = 0, rowsWritten = 0;
+    float dpi = 72.0f;
+    bool ok = true;
+    uint64_t written = 0, streamStart = 0;
+    std::vector<uint64_t> objOffsets;
+    DeflateWriter z;
+    std::vector<uint8_t> prevRow, filtered[2];
 
-        // TV
-        walls.push_back({853, 550, 10, 100, glm::vec4(0.05f,0.05f,0.05f,1.0f), "TV"});
+    static bool formatFor(const std::string &p, Format &fmt){
+        auto ends = [&](const char* s){
+            size_t n = strlen(s);
+            if(p.size() < n) return false;
+            for(size_t i=0;i<n;i++) if(tolower((unsigned char)p[p.size()-n+i]) != s[i]) return false;
+            return true;
+        };
+        if(ends(".png")){ fmt = FORMAT_PNG; return true; }
+        if(ends(".pdf")){ fmt = FORMAT_PDF; return true; }
+        return false;
     }
-    // ---------------------- Additional compliance features ----------------------
-    void loadTextures() {
-    floorTexture = loadTexture("floor.jpg");
-    wallTexture  = loadTexture("wall.jpg");
-    
-    kitchenTexture = loadTexture("/home/floor.jpg");
-    barTexture     = loadTexture("/home/textures/bar.jpg");
-    tableTexture   = loadTexture("textures/table.jpg");
-    doorTexture    = loadTexture("textures/door.jpg");
+    void put(const void* p, size_t n){
+        if(ok && fwrite(p, 1, n, f) != n) ok = false;
+        written += n;
+    }
+    void print(const char* fmt, ...){
+        char buf[512];
+        va_list args; va_start(args, fmt);
+        int n = vsnprintf(buf, sizeof(buf), fmt, args);
+        va_end(args);
+        put(buf, (size_t)std::min(n, (int)sizeof(buf)-1));
+    }
+    static void be32(uint8_t* p, uint32_t v){ p[0]=(uint8_t)(v>>24); p[1]=(uint8_t)(v>>16); p[2]=(uint8_t)(v>>8); p[3]=(uint8_t)v; }
+    void pngChunk(const char type[4], const uint8_t* data, size_t n){
+        uint8_t head[8]; be32(head, (uint32_t)n); memcpy(head+4, type, 4);
+        put(head, 8);
+        if(n) put(data, n);
+        uint32_t crc = crc32Update(crc32Update(0, head+4, 4), data, n);
+        uint8_t tail[4]; be32(tail, crc);
+        put(tail, 4);
+    }
+    // Takes the compressed bytes produced so far.
+    void drain(){
+        if(z.out.empty()) return;
+        if(format==FORMAT_PNG) pngChunk("IDAT", z.out.data(), z.out.size());
+        else put(z.out.data(), z.out.size());
+        z.out.clear();
     }
 
-    void drawDoorSwings() {
-    if (!showDoorSwings) return;
+    bool open(const std::string &p, Format fmt, int w, int h, float dotsPerInch){
+        path = p; format = fmt; width = w; height = h; dpi = dotsPerInch;
+        rowsWritten = 0; ok = true; written = 0; objOffsets.clear();
+        f = fopen(p.c_str(), "wb");
+        if(!f){ std::cerr<<"Export: cannot write "<<p<<"\n"; return false; }
+        prevRow.assign((size_t)w*3, 0);
+        for(auto &r: filtered) r.resize((size_t)w*3 + 1);
+        z.begin();
+        if(format==FORMAT_PNG){
+            static const uint8_t sig[8] = {0x89,'P','N','G','\r','\n',0x1A,'\n'};
+            put(sig, 8);
+            uint8_t ihdr[13] = {};
+            be32(ihdr, (uint32_t)w); be32(ihdr+4, (uint32_t)h);
+            ihdr[8] = 8; ihdr[9] = 2; // 8-bit RGB
+            pngChunk("IHDR", ihdr, 13);
+            uint8_t phys[9] = {};
+            uint32_t ppm = (uint32_t)(dpi / 0.0254f + 0.5f);
+            be32(phys, ppm); be32(phys+4, ppm); phys[8] = 1; // pixels per metre
+            pngChunk("pHYs", phys, 9);
+        } else {
+            // Objects: 1 catalog, 2 pages, 3 page, 4 content stream, 5 image, 6 image length.
+            float pw = w / dpi * 72.0f, ph = h / dpi * 72.0f;
+            char content[128];
+            int cn = snprintf(content, sizeof(content), "q %.3f 0 0 %.3f 0 0 cm /Im0 Do Q\n", pw, ph);
+            print("%%PDF-1.4\n%%\xE2\xE3\xCF\xD3\n");
+            objOffsets.push_back(written); print("1 0 obj\n<< /Type /Catalog /Pages 2 0 R >>\nendobj\n");
+            objOffsets.push_back(written); print("2 0 obj\n<< /Type /Pages /Kids [3 0 R] /Count 1 >>\nendobj\n");
+            objOffsets.push_back(written);
+            print("3 0 obj\n<< /Type /Page /Parent 2 0 R /MediaBox [0 0 %.3f %.3f] /Resources << /XObject << /Im0 5 0 R >> >> /Contents 4 0 R >>\nendobj\n", pw, ph);
+            objOffsets.push_back(written); print("4 0 obj\n<< /Length %d >>\nstream\n%s\nendstream\nendobj\n", cn, content);
+            objOffsets.push_back(written);
+            print("5 0 obj\n<< /Type /XObject /Subtype /Image /Width %d /Height %d /ColorSpace /DeviceRGB /BitsPerComponent 8 "
+                    "/Filter /FlateDecode /DecodeParms << /Predictor 15 /Colors 3 /BitsPerComponent 8 /Columns %d >> /Length 6 0 R >>\nstream\n", w, h, w);
+            streamStart = written;
+        }
+        return ok;
+    }
+    // Filters each row with Sub or Up, whichever leaves the smaller sum of residuals,
+    // then compresses it. `rgb` holds `rows` tightly packed rows.
+    bool writeRows(const uint8_t* rgb, int rows){
+        const size_t stride = (size_t)width*3;
+        for(int r=0;r<rows && rowsWritten<height;r++, rowsWritten++){
+            const uint8_t* row = rgb + r*stride;
+            uint8_t *sub = filtered[0].data(), *up = filtered[1].data();
+            sub[0] = 1; up[0] = 2;
+            uint64_t sumSub = 0, sumUp = 0;
+            for(size_t i=0;i<stride;i++){
+                uint8_t s = (uint8_t)(row[i] - (i >= 3 ? row[i-3] : 0));
+                uint8_t u = (uint8_t)(row[i] - prevRow[i]);
+                sub[i+1] = s; up[i+1] = u;
+                sumSub += s < 128 ? s : 256 - s;
+                sumUp += u < 128 ? u : 256 - u;
+            }
+            const uint8_t* best = rowsWritten > 0 && sumUp < sumSub ? up : sub;
+            z.write(best, stride + 1);
+            memcpy(prevRow.data(), row, stride);
+        }
+        drain();
+        return ok;
+    }
+    bool finish(){
+        if(rowsWritten != height){ std::cerr<<"Export: "<<rowsWritten<<" of "<<height<<" rows written\n"; ok = false; }
+        z.finish();
+        drain();
+        if(format==FORMAT_PNG) pngChunk("IEND", nullptr, 0);
+        else {
+            uint64_t length = written - streamStart;
+            print("\nendstream\nendobj\n");
+            objOffsets.push_back(written); print("6 0 obj\n%llu\nendobj\n", (unsigned long long)length);
+            uint64_t xref = written;
+            print("xref\n0 %d\n0000000000 65535 f \n", (int)objOffsets.size()+1);
+            for(uint64_t off: objOffsets) print("%010llu 00000 n \n", (unsigned long long)off);
+            print("trailer\n<< /Size %d /Root 1 0 R >>\nstartxref\n%llu\n%%%%EOF\n", (int)objOffsets.size()+1, (unsigned long long)xref);
+        }
+        if(fclose(f) != 0) ok = false;
+        f = nullptr;
+        if(!ok){ std::cerr<<"Export: write to "<<path<<" failed\n"; remove(path.c_str()); }
+        return ok;
+    }
+    // Closes and deletes a partial file.
+    void abort(){
+        if(!f) return;
+        fclose(f); f = nullptr;
+        remove(path.c_str());
+    }
+};
 
-    ImDrawList* draw_list = ImGui::GetForegroundDrawList();
-    float sx = scaleX;
-    float sy = scaleY;
-
-    auto worldToScreen = [&](float wx, float wy, ImVec2 &out) -> bool {
-        glm::vec4 clip = proj * glm::vec4(wx * sx, wy * sy, 0.0f, 1.0f);
-        if (clip.w == 0.0f) return false;
-        glm::vec3 ndc = glm::vec3(clip) / clip.w;
-        if (ndc.x < -1.0f || ndc.x > 1.0f || ndc.y < -1.0f || ndc.y > 1.0f) return false;
-        float sx_pix = (ndc.x * 0.5f + 0.5f) * (float)canvasW;
-        float sy_pix = (1.0f - (ndc.y * 0.5f + 0.5f)) * (float)canvasH;
-        out = ImVec2(sx_pix, sy_pix);
-        return true;
-    };
+// ---------------------- Offscreen target ----------------------
+// Color-only framebuffer over one RGBA8 renderbuffer, shared by the tiled export, the
+// benchmark and replay. init() leaves it bound; on failure it releases everything and
+// the default framebuffer is bound again.
+struct OffscreenTarget {
+    GLuint fbo = 0, color = 0;
+
+    bool init(int w, int h){
+        glGenFramebuffers(1, &fbo);
+        glGenRenderbuffers(1, &color);
+        glBindRenderbuffer(GL_RENDERBUFFER, color);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+        if(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE) return true;
+        destroy();
+        return false;
+    }
+    void destroy(){
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if(fbo){ glDeleteFramebuffers(1, &fbo); fbo = 0; }
+        if(color){ glDeleteRenderbuffers(1, &color); color = 0; }
+    }
+};
+
+// ---------------------- Tiled export ----------------------
+// Renders the active plan with its overlays at print resolution (dpi at a 1:N scale,
+// one world unit = 1 cm) into TILE_W x TILE_H tiles of an offscreen FBO. Each tile is
+// read back through a PBO ring guarded by fences and copied into a one-tile-high strip;
+// finished strips are compressed and written on gWorkers, so memory stays at a few
+// strips and the UI keeps running while a 20k x 14k image streams out. step() runs
+// once per frame inside the ImGui frame, within a time budget.
+struct PlanExporter {
+    static constexpr int TILE_W = 2048, TILE_H = 512;
+    static const int PBO_COUNT = 4;
+    static const int MAX_QUEUED_STRIPS = 2; // backpressure on the writer
+    static constexpr double STEP_BUDGET_MS = 8.0;
+    static const int MAX_DIMENSION = 65535;
 
-    for (const auto &d : doors) {
-        ImVec2 center;
-        if (!worldToScreen(d.x, d.y, center)) continue;
+    // Settings (Controls window)
+    char path[256] = "plan_export.png";
+    int dpi = 150;
+    int scaleDen = 50; // 1:50
 
-        float radius = (d.w + d.h) * 0.5f * sx; // scale radius relative to world units
-        int segments = 20;
-        float angleStart = 0.0f;
-        float angleEnd = M_PI_2; // 90-degree swing
+    bool active = false;
+    std::string status;
+    FloorPlan* plan = nullptr;
+    uint64_t revision = 0;
+    ItemBounds area;
+    float ppu = 1.0f; // pixels per world unit
+    int width = 0, height = 0, tilesX = 0, tilesY = 0;
+    int nextTile = 0, tilesRead = 0;
+    OverlayPass overlay; // prepared once for the whole image, drawn into every tile
 
-        // Draw the swing arc
-        for (int i = 0; i < segments; i++) {
-            float a1 = angleStart + (angleEnd - angleStart) * i / segments;
-            float a2 = angleStart + (angleEnd - angleStart) * (i + 1) / segments;
+    OffscreenTarget target;
+    GLuint pbo[PBO_COUNT] = {};
+    GLsync fences[PBO_COUNT] = {};
+    int pboTile[PBO_COUNT];
+    int ringHead = 0, inFlight = 0;
+    std::vector<uint8_t> strip; // RGB rows of the tile row being read back
 
-            // Convert arc points to screen space relative to center
-            ImVec2 p1(center.x + cosf(a1) * radius, center.y + sinf(a1) * radius);
-            ImVec2 p2(center.x + cosf(a2) * radius, center.y + sinf(a2) * radius);
+    // Writer side: strips queued in order and drained by one gWorkers job at a time.
+    struct Strip { std::vector<uint8_t> rgb; int rows = 0; }; // rows == 0: finish
+    StreamingImageWriter writer;
+    std::mutex m;
+    std::deque<Strip> queue;
+    bool writerActive = false, cancelled = false;
+    int stripsWritten = 0;
+    std::atomic<bool> writeDone{false}, writeOk{false};
 
-            draw_list->AddLine(center, p1, IM_COL32(255,128,0,200), 2.0f * sx);
-            draw_list->AddLine(p1, p2, IM_COL32(255,128,0,200), 2.0f * sx);
+    // layoutBounds() walks every item, so the sheet is cached per plan revision.
+    const FloorPlan* boundsPlan = nullptr;
+    uint64_t boundsRevision = 0;
+    ItemBounds bounds;
+    const ItemBounds &sheetBounds(const FloorPlan &p){
+        if(&p != boundsPlan || p.layoutRevision != boundsRevision){
+            bounds = p.layoutBounds().expanded(30.0f);
+            boundsPlan = &p; boundsRevision = p.layoutRevision;
         }
+        return bounds;
+    }
+    void pixelSize(const FloorPlan &p, int &w, int &h){
+        const ItemBounds &b = sheetBounds(p);
+        float s = dpi / 2.54f / scaleDen;
+        w = (int)ceilf((b.x1 - b.x0) * s); h = (int)ceilf((b.y1 - b.y0) * s);
     }
-}
-void drawDimensions() {
-    if(!showDimensions) return;
 
-    ImDrawList* draw_list = ImGui::GetForegroundDrawList();
-    float sx = scaleX, sy = scaleY;
-    ImFont* font = ImGui::GetFont();
-    float fontSize = 12.0f * sx; // scale font size with window
-
-    auto worldToScreen = [&](float wx, float wy, ImVec2 &out) -> bool {
-        glm::vec4 clip = proj * glm::vec4(wx * sx, wy * sy, 0.0f, 1.0f);
-        if(clip.w == 0.0f) return false;
-        glm::vec3 ndc = glm::vec3(clip) / clip.w;
-        if(ndc.x < -1.0f || ndc.x > 1.0f || ndc.y < -1.0f || ndc.y > 1.0f) return false;
-        out = ImVec2((ndc.x*0.5f + 0.5f) * canvasW, (1.0f - (ndc.y*0.5f + 0.5f)) * canvasH);
+    bool start(FloorPlan &p){
+        if(active) return false;
+        { std::lock_guard<std::mutex> lock(m); if(writerActive){ status = "Previous export still closing"; return false; } }
+        StreamingImageWriter::Format fmt;
+        if(!StreamingImageWriter::formatFor(path, fmt)){ status = "Export path must end in .png or .pdf"; return false; }
+        area = sheetBounds(p);
+        ppu = dpi / 2.54f / scaleDen;
+        pixelSize(p, width, height);
+        if(width < 1 || height < 1 || width > MAX_DIMENSION || height > MAX_DIMENSION){
+            status = "Export size out of range"; return false;
+        }
+        if(!writer.open(path, fmt, width, height, (float)dpi)){ status = "Cannot write file"; return false; }
+
+        bool complete = target.init(TILE_W, TILE_H);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if(!complete){
+            std::cerr<<"Export: offscreen framebuffer incomplete\n";
+            writer.abort(); releaseGL();
+            status = "Offscreen framebuffer incomplete"; return false;
+        }
+        glGenBuffers(PBO_COUNT, pbo);
+        for(int i=0;i<PBO_COUNT;i++){
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[i]);
+            glBufferData(GL_PIXEL_PACK_BUFFER, (size_t)TILE_W*TILE_H*4, nullptr, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        plan = &p; revision = p.layoutRevision;
+        tilesX = (width + TILE_W - 1) / TILE_W; tilesY = (height + TILE_H - 1) / TILE_H;
+        nextTile = tilesRead = 0; ringHead = inFlight = 0;
+        strip.assign((size_t)width*TILE_H*3, 0);
+        { std::lock_guard<std::mutex> lock(m); queue.clear(); writerActive = false; cancelled = false; stripsWritten = 0; }
+        writeDone.store(false); writeOk.store(false);
+        // Tiles and the live frames in between share one build of the whole image.
+        p.pinGeometry(area, ppu);
+
+        // Overlays are queued, projected and placed once in image pixels, so labels are
+        // decluttered over the whole sheet and never split differently at tile seams.
+        Camera saved = p.camera; int savedW = p.canvasW, savedH = p.canvasH;
+        setView(p, width*0.5f, height*0.5f, width, height);
+        p.queueOverlays(overlay);
+        overlay.project();
+        overlay.prepare(ImGui::GetFont());
+        p.camera = saved; p.updateProjection(savedW, savedH);
+
+        active = true;
+        status = "Exporting";
+        std::cerr<<"Export: "<<width<<"x"<<height<<" px in "<<tilesX*tilesY<<" tiles to "<<path<<"\n";
         return true;
-    };
+    }
+    // Points the plan camera at image pixel (px,py) on a w x h canvas at export scale.
+    void setView(FloorPlan &p, float px, float py, int w, int h){
+        float fit = std::min((float)w / 1200.0f, (float)h / 800.0f);
+        p.camera.cx = area.x0 + px / ppu;
+        p.camera.cy = area.y0 + py / ppu;
+        p.camera.zoom = ppu / fit;
+        p.updateProjection(w, h);
+    }
 
-    auto drawLineWithArrow = [&](ImVec2 p0, ImVec2 p1){
-        draw_list->AddLine(p0, p1, IM_COL32(0,0,0,255), 1.5f);
-        float arrowSize = 5.0f * sx;
-        draw_list->AddLine(p0, ImVec2(p0.x+arrowSize,p0.y+arrowSize), IM_COL32(0,0,0,255), 1.5f);
-        draw_list->AddLine(p1, ImVec2(p1.x-arrowSize,p1.y-arrowSize), IM_COL32(0,0,0,255), 1.5f);
-    };
+    void step(FloorPlan &live, SceneShaders &sh){
+        if(!active) return;
+        if(&live != plan || live.layoutRevision != revision){ cancel("Cancelled: the plan changed"); return; }
+        if(writeDone.load(std::memory_order_acquire)){
+            bool ok = writeOk.load();
+            finishGL();
+            status = ok ? "Wrote " + std::string(path) : "Export failed";
+            if(ok) std::cerr<<"Export: wrote "<<path<<"\n";
+            return;
+        }
+        typedef std::chrono::steady_clock Clock;
+        auto begin = Clock::now();
+        auto elapsedMs = [&]{ return std::chrono::duration<double, std::milli>(Clock::now() - begin).count(); };
 
-    auto drawRectDims = [&](const std::vector<RectItem> &items){
-        for(const auto &r: items){
-            // Horizontal
-            ImVec2 p0, p1;
-            if(worldToScreen(r.x, r.y+r.h+5, p0) && worldToScreen(r.x+r.w, r.y+r.h+5, p1)){
-                drawLineWithArrow(p0,p1);
-                char buf[32]; snprintf(buf,32,"%.0f", r.w);
-                ImVec2 textSize = ImGui::CalcTextSize(buf);
-                ImVec2 textPos((p0.x+p1.x-textSize.x)*0.5f, p0.y - textSize.y*0.5f);
-                draw_list->AddRectFilled(ImVec2(textPos.x-2,textPos.y-1), ImVec2(textPos.x+textSize.x+2,textPos.y+textSize.y+1), IM_COL32(255,255,255,200));
-                draw_list->AddText(font,fontSize,textPos,IM_COL32(0,0,0,255),buf);
-            }
-            // Vertical
-            if(worldToScreen(r.x+r.w+5, r.y, p0) && worldToScreen(r.x+r.w+5, r.y+r.h, p1)){
-                drawLineWithArrow(p0,p1);
-                char buf[32]; snprintf(buf,32,"%.0f", r.h);
-                ImVec2 textSize = ImGui::CalcTextSize(buf);
-                ImVec2 textPos(p0.x - textSize.x*0.5f, (p0.y+p1.y-textSize.y)*0.5f);
-                draw_list->AddRectFilled(ImVec2(textPos.x-2,textPos.y-1), ImVec2(textPos.x+textSize.x+2,textPos.y+textSize.y+1), IM_COL32(255,255,255,200));
-                draw_list->AddText(font,fontSize,textPos,IM_COL32(0,0,0,255),buf);
-            }
+        drainReadbacks();
+        const int tileCount = tilesX*tilesY;
+        if(nextTile < tileCount && inFlight < PBO_COUNT && queuedStrips() < MAX_QUEUED_STRIPS){
+            Camera saved = plan->camera; int savedW = plan->canvasW, savedH = plan->canvasH;
+            glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+            while(nextTile < tileCount && inFlight < PBO_COUNT && elapsedMs() < STEP_BUDGET_MS) renderTile(sh, nextTile++);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            plan->camera = saved; plan->updateProjection(savedW, savedH);
         }
-    };
+        gRedraw.request(); // keep frames coming until the file is done
+    }
 
-    // Draw dimensions for all relevant rects
-    drawRectDims(walls);
-    //drawRectDims(kitchen);
-    drawRectDims(bar);
-    drawRectDims(windows);
-    //drawRectDims(restrooms);
-    //drawRectDims(fire);
-    //drawRectDims(tablesRect);
-}
-void drawFloorDrains() {
-    if (!showDrains) return;
+    void renderTile(SceneShaders &sh, int tile){
+        int x0 = (tile % tilesX) * TILE_W, y0 = (tile / tilesX) * TILE_H;
+        setView(*plan, x0 + TILE_W*0.5f, y0 + TILE_H*0.5f, TILE_W, TILE_H);
+        glClearColor(1.0f, 1.0f, 1.0f, 1.0f); // paper
+        glClear(GL_COLOR_BUFFER_BIT);
+        plan->render(sh);
+        drawTileOverlays(x0, y0);
 
-    ImDrawList* draw_list = ImGui::GetForegroundDrawList();
-    float sx = scaleX;
-
-    auto worldToScreen = [&](float wx, float wy, ImVec2 &out) -> bool {
-        glm::vec4 clip = proj * glm::vec4(wx * sx, wy * sx, 0.0f, 1.0f);
-        if (clip.w == 0.0f) return false;
-        glm::vec3 ndc = glm::vec3(clip) / clip.w;
-        if (ndc.x < -1.0f || ndc.x > 1.0f || ndc.y < -1.0f || ndc.y > 1.0f) return false;
-        out = ImVec2((ndc.x*0.5f+0.5f)*canvasW, (1.0f-(ndc.y*0.5f+0.5f))*canvasH);
-        return true;
-    };
+        int slot = (ringHead + inFlight) % PBO_COUNT;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[slot]);
+        glReadPixels(0, 0, TILE_W, TILE_H, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        pboTile[slot] = tile;
+        inFlight++;
+    }
+    // Draws the prepared overlays shifted into this tile through the ImGui backend,
+    // using a draw list of our own so the frame's lists are untouched.
+    void drawTileOverlays(int x0, int y0){
+        ImGuiIO &io = ImGui::GetIO();
+        ImDrawList dl(ImGui::GetDrawListSharedData());
+        dl._ResetForNewFrame();
+        dl.PushClipRect(ImVec2(0.0f, 0.0f), ImVec2((float)TILE_W, (float)TILE_H));
+#if IMGUI_VERSION_NUM >= 19200
+        dl.PushTexture(io.Fonts->TexRef);
+#else
+        dl.PushTextureID(io.Fonts->TexID);
+#endif
+        overlay.draw(&dl, ImGui::GetFont(), ImVec2((float)-x0, (float)-y0), ImVec4((float)x0, (float)y0, (float)(x0+TILE_W), (float)(y0+TILE_H)));
+        if(dl.VtxBuffer.Size == 0) return;
+        ImDrawData dd;
+        dd.Valid = true;
+        dd.DisplayPos = ImVec2(0.0f, 0.0f);
+        dd.DisplaySize = ImVec2((float)TILE_W, (float)TILE_H);
+        dd.FramebufferScale = ImVec2(1.0f, 1.0f);
+#if IMGUI_VERSION_NUM >= 18980
+        dd.AddDrawList(&dl);
+#else
+        ImDrawList* lists[1] = {&dl};
+        dd.CmdLists = lists; dd.CmdListsCount = 1;
+        dd.TotalVtxCount = dl.VtxBuffer.Size; dd.TotalIdxCount = dl.IdxBuffer.Size;
+#endif
+#if IMGUI_VERSION_NUM >= 19200
+        dd.Textures = &ImGui::GetPlatformIO().Textures;
+#endif
+        ImGui_ImplOpenGL3_RenderDrawData(&dd);
+    }
 
-    ImFont* font = ImGui::GetFont();
-    float fontSize = 12.0f * sx;
+    // Copies every finished readback (in issue order) into the strip, flipping GL's
+    // bottom-up rows and dropping alpha and the padding past the image edge.
+    void drainReadbacks(){
+        while(inFlight > 0){
+            int slot = ringHead;
+            GLenum r = glClientWaitSync(fences[slot], 0, 0);
+            if(r != GL_ALREADY_SIGNALED && r != GL_CONDITION_SATISFIED) break;
+            glDeleteSync(fences[slot]); fences[slot] = 0;
+            int tile = pboTile[slot];
+            int tx = tile % tilesX, ty = tile / tilesX;
+            int x0 = tx*TILE_W, y0 = ty*TILE_H;
+            int w = std::min(TILE_W, width - x0), h = std::min(TILE_H, height - y0);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[slot]);
+            const uint8_t* px = (const uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (size_t)TILE_W*TILE_H*4, GL_MAP_READ_BIT);
+            if(px){
+                for(int y=0;y<h;y++){
+                    const uint8_t* src = px + (size_t)(TILE_H-1-y)*TILE_W*4;
+                    uint8_t* dst = strip.data() + ((size_t)y*width + x0)*3;
+                    for(int x=0;x<w;x++){ dst[0]=src[0]; dst[1]=src[1]; dst[2]=src[2]; dst += 3; src += 4; }
+                }
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            ringHead = (ringHead + 1) % PBO_COUNT; inFlight--;
+            tilesRead++;
+            if(tx == tilesX-1){ // strip complete
+                Strip s;
+                s.rgb.swap(strip);
+                s.rows = h;
+                strip.assign((size_t)width*TILE_H*3, 0);
+                enqueue(std::move(s));
+                if(ty == tilesY-1) enqueue(Strip()); // finish marker
+            }
+        }
+    }
+    int queuedStrips(){ std::lock_guard<std::mutex> lock(m); return (int)queue.size(); }
+    void enqueue(Strip s){
+        {
+            std::lock_guard<std::mutex> lock(m);
+            queue.push_back(std::move(s));
+            if(writerActive) return;
+            writerActive = true;
+        }
+        gWorkers.submit([this]{ writeQueued(); }); // runs inline when the pool is not started
+    }
+    // gWorkers: compresses and writes queued strips until the queue runs dry.
+    void writeQueued(){
+        for(;;){
+            Strip s;
+            {
+                std::lock_guard<std::mutex> lock(m);
+                if(cancelled){ writer.abort(); writerActive = false; return; }
+                if(queue.empty()){ writerActive = false; return; }
+                s = std::move(queue.front()); queue.pop_front();
+            }
+            if(s.rows == 0){
+                writeOk.store(writer.finish());
+                writeDone.store(true, std::memory_order_release);
+            } else {
+                writer.writeRows(s.rgb.data(), s.rows);
+                std::lock_guard<std::mutex> lock(m);
+                stripsWritten++;
+            }
+            gRedraw.request();
+        }
+    }
 
-    for (const auto &d : drains) {
-        ImVec2 screenPos;
-        if (!worldToScreen(d.x, d.y, screenPos)) continue;
-        draw_list->AddCircleFilled(screenPos, d.r*sx, IM_COL32((int)(d.color.r*255),(int)(d.color.g*255),(int)(d.color.b*255),255), 12);
+    void cancel(const char* why = "Cancelled"){
+        if(!active) return;
+        {
+            std::lock_guard<std::mutex> lock(m);
+            queue.clear(); cancelled = true;
+            if(!writerActive) writer.abort(); // otherwise the running job aborts it
+        }
+        finishGL();
+        status = why;
+    }
+    void finishGL(){
+        active = false;
+        if(plan) plan->unpinGeometry();
+        plan = nullptr;
+        overlay.begin(ScreenTransform(), 1.0f); // drop item pointers into the plan
+        strip.clear(); strip.shrink_to_fit();
+        releaseGL();
+    }
+    void releaseGL(){
+        for(auto &f: fences) if(f){ glDeleteSync(f); f = 0; }
+        inFlight = 0;
+        if(pbo[0]){ glDeleteBuffers(PBO_COUNT, pbo); for(auto &b: pbo) b = 0; }
+        target.destroy();
+    }
+    // Waits for a running write job; call before gWorkers stops.
+    void shutdown(){
+        cancel();
+        for(;;){
+            { std::lock_guard<std::mutex> lock(m); if(!writerActive) break; }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
 
-        // Draw label
-        if (!d.label.empty()) {
-            ImVec2 textSize = ImGui::CalcTextSize(d.label.c_str());
-            ImVec2 textPos(screenPos.x - textSize.x*0.5f, screenPos.y - d.r*sx - textSize.y - 2);
-            draw_list->AddRectFilled(ImVec2(textPos.x-2, textPos.y-1), ImVec2(textPos.x+textSize.x+2, textPos.y+textSize.y+1), IM_COL32(255,255,255,200));
-            draw_list->AddText(font, fontSize, textPos, IM_COL32(0,0,0,255), d.label.c_str());
+    void drawControls(FloorPlan &p){
+        if(!ImGui::CollapsingHeader("Export")) return;
+        ImGui::InputText("Export File", path, sizeof(path));
+        ImGui::SliderInt("DPI", &dpi, 72, 1200);
+        ImGui::SliderInt("Scale 1:", &scaleDen, 10, 500);
+        int w, h; pixelSize(p, w, h);
+        ImGui::Text("%d x %d px (%.1f MB raw)", w, h, (double)w*h*3/(1024.0*1024.0));
+        if(!active){
+            if(ImGui::Button("Export")) start(p);
+        } else {
+            int tiles = tilesX*tilesY, written;
+            { std::lock_guard<std::mutex> lock(m); written = stripsWritten; }
+            ImGui::ProgressBar((tilesRead / (float)tiles + written / (float)tilesY) * 0.5f);
+            ImGui::SameLine(); if(ImGui::Button("Cancel")) cancel();
         }
+        if(!status.empty()) ImGui::TextUnformatted(status.c_str());
     }
-}
-    void drawScaleBar() {
-    ImDrawList* draw_list = ImGui::GetForegroundDrawList();
-    float sx = scaleX;
-    float sy = scaleY;
+};
+static PlanExporter gExport;
 
-    // Example: scale bar starts at world coordinates (60, 40)
-    float wx0 = 60.0f;
-    float wy0 = 40.0f;
-    float length_m = 100.0f; // 1 meter in world units
+// ---------------------- Frame capture ----------------------
+// "Capture Frame" records the next frame's main pass through gRecorder, then appends the
+// ImGui draw lists and the FloorPlan state that produced them (binary layout, camera,
+// toggles) and writes one file. `--replay` (see the benchmark section) re-executes it
+// offscreen. Textures are not stored: the replay rebuilds them from the embedded layout
+// and the app's own assets, which keeps field captures small and free of venue imagery.
+static const uint32_t CAPTURE_MAGIC = 0x50414346; // "FCAP"
+static const uint32_t CAPTURE_VERSION = 1;
 
-    auto worldToScreen = [&](float wx, float wy, ImVec2 &out) -> bool {
-        glm::vec4 clip = proj * glm::vec4(wx * sx, wy * sy, 0.0f, 1.0f);
-        if (clip.w == 0.0f) return false;
-        glm::vec3 ndc = glm::vec3(clip) / clip.w;
-        if (ndc.x < -1.0f || ndc.x > 1.0f || ndc.y < -1.0f || ndc.y > 1.0f) return false;
-        float sx_pix = (ndc.x * 0.5f + 0.5f) * (float)canvasW;
-        float sy_pix = (1.0f - (ndc.y * 0.5f + 0.5f)) * (float)canvasH;
-        out = ImVec2(sx_pix, sy_pix);
-        return true;
-    };
+struct CaptureView {
+    float cx, cy, zoom, scaleX, scaleY;
+    int32_t canvasW, canvasH;
+    float clear[4];
+    float fieldFrameMs; // CPU time of the frame before the capture, on the capturing machine
+    uint8_t showGrid, showLabels, showDoorSwings, showDimensions, showDrains, showScaleBar, showWindows, showDoors;
+    uint8_t showFrontElevation, showSideElevation, useInstancing, useAnalyticShapes, declutter, editMode;
+    uint8_t selectedCat;
+    uint32_t selectedIndex;
+};
+struct CaptureHeader {
+    uint32_t magic, version;
+    uint32_t idxSize; // sizeof(ImDrawIdx) of the capturing build
+    uint32_t opCount, drawCount, blobCount, nameCount, listCount;
+    char renderer[64];
+    CaptureView view;
+    uint64_t layoutAt, layoutBytes;
+    uint64_t namesAt, namesBytes;   // '\0'-terminated, in id order
+    uint64_t blobsAt;               // blobCount x FrameRecorder::Blob, offsets into data
+    uint64_t dataAt, dataBytes;
+    uint64_t opsAt, opsBytes;
+    uint64_t imguiAt, imguiBytes;   // CaptureDisplay, then per list: counts, vertices, indices, CaptureCmds
+    uint64_t fileSize;
+};
+struct CaptureDisplay { float pos[2], size[2], scale[2]; };
+struct CaptureCmd {
+    float clip[4];
+    uint32_t vtxOffset, idxOffset, elemCount;
+    uint8_t role;
+};
+
+struct FrameCapture {
+    char path[256] = "frame.fcap";
+    bool armed = false; // capture the next frame
+    std::string status;
+    CaptureView view{};
 
-    ImVec2 start, end;
-    if (!worldToScreen(wx0, wy0, start)) return;
-    if (!worldToScreen(wx0 + length_m, wy0, end)) return;
+    // Start of the main pass: forget every cache so the stream is self-contained.
+    void begin(FloorPlan &p, SceneShaders &sh, const float clear[4]){
+        if(!armed) return;
+        armed = false;
+        gRecorder.textureRoles.clear();
+        gRecorder.textureRoles[gSceneTextures.tex] = TR_SCENE_LAYERS;
+        if(p.frontElevation.tex) gRecorder.textureRoles[p.frontElevation.tex] = TR_FRONT_ELEVATION;
+        if(p.sideElevation.tex) gRecorder.textureRoles[p.sideElevation.tex] = TR_SIDE_ELEVATION;
+        GLuint font = fontTexture();
+        if(font) gRecorder.textureRoles[font] = TR_FONT;
+        sh.forgetUniforms();
+        gGLState.invalidate();
 
-    draw_list->AddLine(start, end, IM_COL32(0,0,0,255), 2.0f * sx);
-    draw_list->AddText(ImVec2(start.x, start.y - 20.0f*sx), IM_COL32(0,0,0,255), "1 m");
+        view = CaptureView{};
+        view.cx = p.camera.cx; view.cy = p.camera.cy; view.zoom = p.camera.zoom;
+        view.scaleX = p.scaleX; view.scaleY = p.scaleY;
+        view.canvasW = p.canvasW; view.canvasH = p.canvasH;
+        memcpy(view.clear, clear, sizeof(view.clear));
+        view.fieldFrameMs = gProfiler.frameMs[(gProfiler.historyPos + Profiler::HISTORY - 1) % Profiler::HISTORY];
+        view.showGrid = p.showGrid; view.showLabels = p.showLabels; view.showDoorSwings = p.showDoorSwings;
+        view.showDimensions = p.showDimensions; view.showDrains = p.showDrains; view.showScaleBar = p.showScaleBar;
+        view.showWindows = p.showWindows; view.showDoors = p.showDoors;
+        view.showFrontElevation = p.showFrontElevation; view.showSideElevation = p.showSideElevation;
+        view.useInstancing = p.useInstancing; view.useAnalyticShapes = p.useAnalyticShapes;
+        view.declutter = p.overlay.declutter; view.editMode = p.editMode;
+        view.selectedCat = p.selected.cat; view.selectedIndex = p.selected.index;
+        gRecorder.start();
+    }
+    // After the ImGui lists are drawn: stop recording and write the file.
+    void finish(FloorPlan &p, ImDrawData *dd){
+        if(!gRecorder.recording) return;
+        gRecorder.stop();
+        bool ok = write(p, dd);
+        status = ok ? "Captured " + std::to_string(gRecorder.drawCount) + " draws to " + path : "Capture failed";
+        if(ok) std::cerr<<"Capture: wrote "<<path<<"\n";
+    }
+    static GLuint fontTexture(){
+#if IMGUI_VERSION_NUM >= 19200
+        return (GLuint)(uintptr_t)ImGui::GetIO().Fonts->TexRef.GetTexID();
+#else
+        return (GLuint)(uintptr_t)ImGui::GetIO().Fonts->TexID;
+#endif
     }
 
-    void drawLabels() {
-    if(!showLabels) return;
+    bool write(FloorPlan &p, ImDrawData *dd){
+        CaptureHeader hdr{};
+        hdr.magic = CAPTURE_MAGIC; hdr.version = CAPTURE_VERSION;
+        hdr.idxSize = sizeof(ImDrawIdx);
+        hdr.opCount = gRecorder.opCount; hdr.drawCount = gRecorder.drawCount;
+        hdr.blobCount = (uint32_t)gRecorder.blobs.size(); hdr.nameCount = (uint32_t)gRecorder.names.size();
+        const char *renderer = (const char*)glGetString(GL_RENDERER);
+        snprintf(hdr.renderer, sizeof(hdr.renderer), "%s", renderer ? renderer : "");
+        hdr.view = view;
 
-    ImDrawList* draw_list = ImGui::GetForegroundDrawList();
-    float sx = scaleX;
-    float sy = scaleY;
-    ImFont* font = ImGui::GetFont();
-    float fontSize = 14.0f * sx;
-
-    auto worldToScreen = [&](float wx, float wy, ImVec2 &out) -> bool {
-        glm::vec4 clip = proj * glm::vec4(wx * sx, wy * sy, 0.0f, 1.0f);
-        if (clip.w == 0.0f) return false;
-        glm::vec3 ndc = glm::vec3(clip) / clip.w;
-        if (ndc.x < -1.0f || ndc.x > 1.0f || ndc.y < -1.0f || ndc.y > 1.0f) return false;
-        float sx_pix = (ndc.x * 0.5f + 0.5f) * (float)canvasW;
-        float sy_pix = (1.0f - (ndc.y * 0.5f + 0.5f)) * (float)canvasH;
-        out = ImVec2(sx_pix, sy_pix);
-        return true;
-    };
-    auto drawRectLabels = [&](auto const &items){
-    for (const auto &r : items) {
-        if (r.label.empty()) continue;
-        float cx = r.x + r.w*0.5f;
-        float cy = r.y + r.h*0.5f;
-        ImVec2 screenPos;
-        if(!worldToScreen(cx, cy, screenPos)) continue;
-        ImVec2 textSize = ImGui::CalcTextSize(r.label.c_str());
-        ImVec2 textPos(screenPos.x - textSize.x*0.5f, screenPos.y - textSize.y*0.5f);
-        ImU32 bg = IM_COL32(255,255,255,200);
-        draw_list->AddRectFilled(ImVec2(textPos.x-4,textPos.y-2),
-                                 ImVec2(textPos.x+textSize.x+4,textPos.y+textSize.y+2),
-                                 bg);
-        draw_list->AddText(font, fontSize, textPos, IM_COL32(0,0,0,255), r.label.c_str());
-    }
-   };
-    auto drawCircleLabels = [&](const std::vector<CircleItem> &items){
-        for(const auto &c: items){
-            if(c.label.empty()) continue;
-            ImVec2 screenPos;
-            if(!worldToScreen(c.x, c.y, screenPos)) continue;
-            ImVec2 textSize = ImGui::CalcTextSize(c.label.c_str());
-            ImVec2 textPos(screenPos.x - textSize.x * 0.5f, screenPos.y - textSize.y * 0.5f);
-            ImU32 bg = IM_COL32(255,255,255,200);
-            draw_list->AddRectFilled(ImVec2(textPos.x - 4, textPos.y - 2),
-                                     ImVec2(textPos.x + textSize.x + 4, textPos.y + textSize.y + 2),
-                                     bg);
-            draw_list->AddText(font, fontSize, textPos, IM_COL32(0,0,0,255), c.label.c_str());
+        std::vector<unsigned char> buf(sizeof(hdr));
+        auto put = [&](const void *src, size_t bytes) -> uint64_t {
+            buf.resize((buf.size()+15) & ~(size_t)15);
+            uint64_t at = buf.size();
+            buf.insert(buf.end(), (const unsigned char*)src, (const unsigned char*)src + bytes);
+            return at;
+        };
+        std::vector<unsigned char> layout = p.encodeBinaryLayout();
+        hdr.layoutAt = put(layout.data(), layout.size()); hdr.layoutBytes = layout.size();
+        std::string names;
+        for(auto &n: gRecorder.names){ names += n; names += '\0'; }
+        hdr.namesAt = put(names.data(), names.size()); hdr.namesBytes = names.size();
+        hdr.blobsAt = put(gRecorder.blobs.data(), gRecorder.blobs.size()*sizeof(FrameRecorder::Blob));
+        hdr.dataAt = put(gRecorder.data.data(), gRecorder.data.size()); hdr.dataBytes = gRecorder.data.size();
+        hdr.opsAt = put(gRecorder.ops.data(), gRecorder.ops.size()); hdr.opsBytes = gRecorder.ops.size();
+
+        std::vector<unsigned char> ui;
+        auto append = [&](const void *src, size_t bytes){ ui.insert(ui.end(), (const unsigned char*)src, (const unsigned char*)src + bytes); };
+        CaptureDisplay disp{{dd->DisplayPos.x, dd->DisplayPos.y}, {dd->DisplaySize.x, dd->DisplaySize.y}, {dd->FramebufferScale.x, dd->FramebufferScale.y}};
+        append(&disp, sizeof(disp));
+        for(int n=0;n<dd->CmdListsCount;n++){
+            const ImDrawList *dl = dd->CmdLists[n];
+            std::vector<CaptureCmd> cmds;
+            for(const ImDrawCmd &c: dl->CmdBuffer){
+                if(c.UserCallback) continue; // backend callbacks can't be replayed
+                CaptureCmd cc{};
+                cc.clip[0] = c.ClipRect.x; cc.clip[1] = c.ClipRect.y; cc.clip[2] = c.ClipRect.z; cc.clip[3] = c.ClipRect.w;
+                cc.vtxOffset = c.VtxOffset; cc.idxOffset = c.IdxOffset; cc.elemCount = c.ElemCount;
+                cc.role = gRecorder.role((GLuint)(uintptr_t)c.GetTexID());
+                cmds.push_back(cc);
+            }
+            uint32_t counts[3] = {(uint32_t)dl->VtxBuffer.Size, (uint32_t)dl->IdxBuffer.Size, (uint32_t)cmds.size()};
+            append(counts, sizeof(counts));
+            append(dl->VtxBuffer.Data, dl->VtxBuffer.Size*sizeof(ImDrawVert));
+            append(dl->IdxBuffer.Data, dl->IdxBuffer.Size*sizeof(ImDrawIdx));
+            append(cmds.data(), cmds.size()*sizeof(CaptureCmd));
+            hdr.listCount++;
         }
-    };
+        hdr.imguiAt = put(ui.data(), ui.size()); hdr.imguiBytes = ui.size();
+        hdr.fileSize = buf.size();
+        memcpy(buf.data(), &hdr, sizeof(hdr));
 
-    drawRectLabels(walls);
-    drawRectLabels(kitchen);
-    drawRectLabels(bar);
-    drawRectLabels(windows);
-    drawRectLabels(restrooms);
-    drawRectLabels(fire);
-    drawRectLabels(tablesRect);
-    drawCircleLabels(tablesCircle);
-    drawRectLabels(doors);
-    drawCircleLabels(drains);
-   }
+        std::string tmp = std::string(path) + ".tmp";
+        FILE* f = fopen(tmp.c_str(), "wb");
+        if(!f){ std::cerr<<"Capture: cannot write "<<tmp<<"\n"; return false; }
+        bool ok = fwrite(buf.data(), 1, buf.size(), f)==buf.size();
+        ok = (fclose(f)==0) && ok;
+        if(ok) ok = rename(tmp.c_str(), path)==0;
+        if(!ok){ remove(tmp.c_str()); std::cerr<<"Capture: failed to write "<<path<<"\n"; }
+        return ok;
+    }
 
-void drawDoorSwingElevation(float x, float y, float w, float h, bool isFront=true) {
-    ImDrawList* draw_list = ImGui::GetForegroundDrawList();
-    float sx = scaleX, sy = scaleY;
-    float groundY = 600.0f;
+    void drawControls(){
+        if(!ImGui::CollapsingHeader("Frame Capture")) return;
+        ImGui::InputText("Capture File", path, sizeof(path));
+        if(ImGui::Button("Capture Frame")){ armed = true; gRedraw.request(); }
+        if(!status.empty()) ImGui::TextUnformatted(status.c_str());
+    }
+};
+static FrameCapture gCapture;
 
-    ImVec2 center(x*sx, groundY - h*sy);
-    float radius = w * 0.5f * sx;
-    int segments = 20;
+// ---------------------- GLFW + Main ----------------------
+static SceneManager gScenes;
+static SceneShaders gShaders;
+static int gWinW=1280,gWinH=800;
+static void framebuffer_size_cb(GLFWwindow*, int w,int h){
+    if(w>0 && h>0){ gWinW=w; gWinH=h; gScenes.resize(w,h); }
+}
+// ---------------------- Benchmark ----------------------
+// `--bench` runs a fixed camera path over a synthetic (or given) layout in a hidden
+// window, rendering into an offscreen FBO with every overlay and both elevations on,
+// and prints a JSON report: frame-time percentiles, per-pass CPU/GPU means, and draw
+// calls, upload bytes and allocations per frame. glFinish ends each frame so the
+// times include the GPU.
+struct BenchOptions {
+    bool enabled = false;
+    size_t items = 10000;
+    int frames = 600, warmup = 30;
+    int width = 1920, height = 1080;
+    uint32_t seed = 1;
+    std::string layout; // empty: setupSyntheticLayout(items, seed)
+    std::string out;    // report path; stdout when empty
+    std::string replay; // --replay: frame capture to re-execute instead
+};
 
-    for(int i=0; i<=segments; i++) {
-        float a0 = (M_PI/2.0f) * i/segments;
-        float a1 = (M_PI/2.0f) * (i+1)/segments;
-        ImVec2 p0 = ImVec2(center.x + radius*cos(a0), center.y + radius*sin(a0));
-        ImVec2 p1 = ImVec2(center.x + radius*cos(a1), center.y + radius*sin(a1));
-        draw_list->AddLine(p0,p1, IM_COL32(0,0,0,255), 1.0f);
+// Consumes argv[i] (and its value) when it is a bench flag.
+static bool parseBenchArg(BenchOptions &opt, int argc, char** argv, int &i){
+    std::string a = argv[i];
+    bool hasValue = i+1 < argc;
+    if(a=="--bench"){ opt.enabled = true; return true; }
+    if(a=="--replay" && hasValue){ opt.replay = argv[++i]; return true; }
+    if(a=="--items" && hasValue){ opt.items = strtoull(argv[++i], nullptr, 10); return true; }
+    if(a=="--frames" && hasValue){ opt.frames = std::max(1, atoi(argv[++i])); return true; }
+    if(a=="--warmup" && hasValue){ opt.warmup = std::max(0, atoi(argv[++i])); return true; }
+    if(a=="--seed" && hasValue){ opt.seed = (uint32_t)strtoul(argv[++i], nullptr, 10); return true; }
+    if(a=="--out" && hasValue){ opt.out = argv[++i]; return true; }
+    if(a=="--size" && hasValue){
+        int w=0, h=0;
+        if(sscanf(argv[++i], "%dx%d", &w, &h)!=2 || w<=0 || h<=0){ std::cerr<<"--size expects WxH\n"; return true; }
+        opt.width = w; opt.height = h; return true;
     }
+    return false;
 }
 
-void drawFrontElevationView() {
-    if (!showFrontElevation) return;
-
-    ImGui::Begin("Front Elevation");
-    ImDrawList* dl = ImGui::GetWindowDrawList();
-    ImVec2 origin = ImGui::GetCursorScreenPos();
-    float scale = 0.5f;  // elevation scale
-    float groundY = origin.y + 300.0f;  // baseline for walls
-
-    // Draw baseline
-    dl->AddLine(ImVec2(origin.x, groundY), ImVec2(origin.x+1200*scale, groundY),
-                IM_COL32(0,0,0,255), 2.0f);
-
-    // Draw walls as vertical extrusions
-    for (auto &w : walls) {
-        float x0 = origin.x + w.x * scale;
-        float x1 = origin.x + (w.x + w.w) * scale;
-        float y0 = groundY;
-        float y1 = groundY - wallHeight * scale;
-        dl->AddRectFilled(ImVec2(x0, y1), ImVec2(x1, y0),
-            IM_COL32((int)(w.color.r*255),(int)(w.color.g*255),(int)(w.color.b*255),255));
-        dl->AddRect(ImVec2(x0, y1), ImVec2(x1, y0), IM_COL32(0,0,0,255));
-    }
-
-    // Draw windows
-    for (auto &win : windows) {
-        float x0 = origin.x + win.x * scale;
-        float x1 = origin.x + (win.x + win.w) * scale;
-        float y0 = groundY - windowSill * scale;
-        float y1 = y0 - windowHeight * scale;
-        dl->AddRectFilled(ImVec2(x0, y1), ImVec2(x1, y0), IM_COL32(120,180,255,255));
-        dl->AddRect(ImVec2(x0, y1), ImVec2(x1, y0), IM_COL32(0,0,0,255));
-    }
-
-    // Draw doors
-    for (auto &d : doors) {
-        float x0 = origin.x + d.x * scale;
-        float x1 = origin.x + (d.x + d.w) * scale;
-        float y0 = groundY;
-        float y1 = y0 - doorHeight * scale;
-        dl->AddRectFilled(ImVec2(x0, y1), ImVec2(x1, y0), IM_COL32(180,100,50,255));
-        dl->AddRect(ImVec2(x0, y1), ImVec2(x1, y0), IM_COL32(0,0,0,255));
-    }
+static double percentile(const std::vector<double> &sorted, double p){
+    if(sorted.empty()) return 0.0;
+    size_t rank = (size_t)ceil(p/100.0 * sorted.size());
+    return sorted[std::min(sorted.size()-1, rank ? rank-1 : 0)];
+}
 
-    ImGui::End();
+// Frame-time stats as one JSON object: mean, percentiles, max.
+static void writeFrameStats(FILE* out, const std::vector<double> &frameMs){
+    std::vector<double> sorted = frameMs;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0.0;
+    for(double v: frameMs) sum += v;
+    fprintf(out, "{\"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p95\": %.3f, \"p99\": %.3f, \"max\": %.3f}",
+            sorted.empty() ? 0.0 : sum/sorted.size(), percentile(sorted, 50), percentile(sorted, 90), percentile(sorted, 95),
+            percentile(sorted, 99), sorted.empty() ? 0.0 : sorted.back());
 }
 
-void drawSideElevationView() {
-    if (!showSideElevation) return;
+static int runBenchmark(const BenchOptions &opt){
+    typedef std::chrono::steady_clock Clock;
+    auto ms = [](Clock::time_point a, Clock::time_point b){ return std::chrono::duration<double, std::milli>(b - a).count(); };
+
+    auto setupStart = Clock::now();
+    FloorPlan plan;
+    if(opt.layout.empty()) plan.setupSyntheticLayout(opt.items, opt.seed);
+    else if(!plan.loadLayout(opt.layout)){ std::cerr<<"Bench: could not load "<<opt.layout<<"\n"; return 1; }
+    plan.initGL(opt.width, opt.height);
+    plan.showGrid = plan.showLabels = plan.showDoorSwings = plan.showDimensions = true;
+    plan.showFrontElevation = plan.showSideElevation = true;
+    plan.buildStaticGeometry();
+    double setupMs = ms(setupStart, Clock::now());
 
-    ImGui::Begin("Side Elevation");
-    ImDrawList* dl = ImGui::GetWindowDrawList();
-    ImVec2 origin = ImGui::GetCursorScreenPos();
-    float scale = 0.5f;
-    float groundY = origin.y + 300.0f;
+    size_t itemCount = 0;
+    for(uint8_t c=0;c<CAT_COUNT;c++) itemCount += plan.categorySize(c);
 
-    dl->AddLine(ImVec2(origin.x, groundY), ImVec2(origin.x+700*scale, groundY),
-                IM_COL32(0,0,0,255), 2.0f);
+    // Textures decode in the background; finish them so uploads stay out of the samples.
+    plan.loadTextures();
+    while(gSceneTextures.busy()){ gSceneTextures.pumpUploads(); std::this_thread::sleep_for(std::chrono::milliseconds(1)); }
+    while(gSceneTextures.pumpUploads()) {}
+    plan.markGeometryDirty();
 
-    for (auto &w : walls) {
-        float depth = w.h; // projecting width as depth
-        float x0 = origin.x;
-        float x1 = origin.x + depth * scale;
-        float y0 = groundY;
-        float y1 = groundY - wallHeight * scale;
-        dl->AddRectFilled(ImVec2(x0, y1), ImVec2(x1, y0),
-            IM_COL32((int)(w.color.r*255),(int)(w.color.g*255),(int)(w.color.b*255),255));
-        dl->AddRect(ImVec2(x0, y1), ImVec2(x1, y0), IM_COL32(0,0,0,255));
+    OffscreenTarget target;
+    if(!target.init(opt.width, opt.height)){
+        std::cerr<<"Bench: offscreen framebuffer incomplete\n";
+        plan.destroy();
+        return 1;
     }
 
-    ImGui::End();
-}
-void updateProjection(int w,int h){
-        canvasW = w;
-        canvasH = h;
-        glViewport(0, 0, w, h);
+    // Camera path: a Lissajous pan over the layout while zoom sweeps 0.25x..8x and back
+    // twice, so culling, LOD switches and geometry rebuilds all happen.
+    ItemBounds ext = plan.layoutBounds();
+    float midX = (ext.x0+ext.x1)*0.5f, midY = (ext.y0+ext.y1)*0.5f;
+    float spanX = (ext.x1-ext.x0)*0.45f, spanY = (ext.y1-ext.y0)*0.45f;
+    const float twoPi = 2.0f*(float)M_PI;
+    const float logMin = logf(Camera::kMinZoom), logMax = logf(8.0f);
 
-        scaleX = (float)w / 1200.0f;
-        scaleY = (float)h / 800.0f;
-        float s = (scaleX < scaleY) ? scaleX : scaleY;
-        scaleX = scaleY = s;
+    std::vector<double> frameMs;
+    frameMs.reserve(opt.frames);
+    Profiler::Counters total;
+    double passCpu[Profiler::MAX_PASSES] = {}, passGpu[Profiler::MAX_PASSES] = {};
+    size_t peakBytes = 0;
+    gProfiler.enabled = true;
+    for(int f=-opt.warmup; f<opt.frames; f++){
+        float t = f < 0 ? 0.0f : (float)f / opt.frames;
+        plan.camera.cx = midX + spanX*sinf(twoPi*2.0f*t);
+        plan.camera.cy = midY + spanY*sinf(twoPi*3.0f*t);
+        plan.camera.zoom = expf(logMin + (logMax-logMin)*(0.5f - 0.5f*cosf(twoPi*2.0f*t)));
+        plan.updateProjection(opt.width, opt.height);
+
+        gProfiler.beginFrame();
+        auto start = Clock::now();
+        glfwPollEvents();
+        ImGui_ImplOpenGL3_NewFrame();
+        ImGui_ImplGlfw_NewFrame();
+        ImGui::NewFrame();
+        { ProfileScope p(gProfiler, "front elevation"); plan.drawFrontElevationView(gShaders); }
+        { ProfileScope p(gProfiler, "side elevation"); plan.drawSideElevationView(gShaders); }
+        glClearColor(0.925f,0.941f,0.945f,1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        { ProfileScope p(gProfiler, "render", true); plan.render(gShaders); }
+        { ProfileScope p(gProfiler, "drawOverlays"); plan.drawOverlays(); }
+        ImGui::Render();
+        { ProfileScope p(gProfiler, "ImGui_ImplOpenGL3_RenderDrawData", true); ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData()); }
+        glFinish();
+        double frame = ms(start, Clock::now());
+        gProfiler.endFrame();
+        if(f < 0) continue;
 
-        float viewW = 1200.0f * scaleX;
-        float viewH = 800.0f * scaleY;
-        proj = glm::ortho(0.0f, viewW, viewH, 0.0f, -1.0f, 1.0f);
+        frameMs.push_back(frame);
+        const Profiler::Counters &c = gProfiler.last;
+        total.drawCalls += c.drawCalls; total.vertices += c.vertices; total.instances += c.instances;
+        total.bytesUploaded += c.bytesUploaded; total.allocations += c.allocations; total.allocBytes += c.allocBytes;
+        for(int i=0;i<gProfiler.passCount;i++){ passCpu[i] += gProfiler.passes[i].cpuMs; passGpu[i] += gProfiler.passes[i].gpuMs; }
+        if(f % 60 == 0) peakBytes = std::max(peakBytes, plan.memoryBytes());
     }
+    peakBytes = std::max(peakBytes, plan.memoryBytes());
 
-void render(GLuint shader) {
-    float sx = scaleX, sy = scaleY;
+    double n = (double)frameMs.size();
 
-    glUseProgram(shader);
-    glUniformMatrix4fv(glGetUniformLocation(shader,"uMVP"),1,GL_FALSE, glm::value_ptr(proj));
+    FILE* out = opt.out.empty() ? stdout : fopen(opt.out.c_str(), "wb");
+    if(!out){ std::cerr<<"Bench: cannot write "<<opt.out<<"\n"; out = stdout; }
+    std::string layoutName;
+    jsonEscape(layoutName, opt.layout.empty() ? std::string("synthetic") : opt.layout);
+    fprintf(out, "{\n  \"layout\": %s,\n", layoutName.c_str());
+    fprintf(out, "  \"items\": %zu,\n  \"seed\": %u,\n  \"width\": %d,\n  \"height\": %d,\n  \"frames\": %d,\n",
+            itemCount, opt.seed, opt.width, opt.height, (int)frameMs.size());
+    fprintf(out, "  \"setup_ms\": %.3f,\n  \"peak_memory_bytes\": %zu,\n", setupMs, peakBytes);
+    fprintf(out, "  \"frame_ms\": ");
+    writeFrameStats(out, frameMs);
+    fprintf(out, ",\n");
+    fprintf(out, "  \"per_frame\": {\"draw_calls\": %.1f, \"vertices\": %.1f, \"instances\": %.1f, \"bytes_uploaded\": %.1f, \"allocations\": %.1f, \"alloc_bytes\": %.1f},\n",
+            total.drawCalls/n, total.vertices/n, total.instances/n, total.bytesUploaded/n, total.allocations/n, total.allocBytes/n);
+    fprintf(out, "  \"totals\": {\"bytes_uploaded\": %llu, \"allocations\": %llu, \"alloc_bytes\": %llu},\n",
+            (unsigned long long)total.bytesUploaded, (unsigned long long)total.allocations, (unsigned long long)total.allocBytes);
+    fprintf(out, "  \"passes\": {");
+    for(int i=0;i<gProfiler.passCount;i++)
+        fprintf(out, "%s\n    \"%s\": {\"cpu_ms\": %.4f, \"gpu_ms\": %.4f}", i ? "," : "", gProfiler.passes[i].name, passCpu[i]/n, passGpu[i]/n);
+    fprintf(out, "\n  }\n}\n");
+    if(out != stdout) fclose(out);
 
-    // ------------------ TRIANGLES ------------------
-    triBuf.begin();
+    target.destroy();
+    plan.destroy();
+    return 0;
+}
 
-    // --- Floor with texture ---
-    glUniform1i(glGetUniformLocation(shader,"useTexture"), true);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, floorTexture);
-    glUniform1i(glGetUniformLocation(shader,"uTexture"), 0);
-    addRectTextured(triBuf, floor[0].x*sx, floor[0].y*sy, floor[0].w*sx, floor[0].h*sy, glm::vec4(1.0f));
+// `--replay capture.fcap` re-executes a frame capture offscreen at its original size. The
+// stream phase replays the recorded draws, uniforms and binds over buffers rebuilt from
+// the captured data, plus the captured ImGui lists: GPU and driver cost with none of the
+// app's CPU work. The app phase rebuilds the FloorPlan from the embedded layout and view
+// and renders it the normal way, which times the CPU side. One JSON report covers both.
+struct ReplayCmd {
+    uint8_t op;
+    GLuint program;
+    GLint loc;
+    uint32_t a, b, c, d;
+    float f[16];
+};
+// Bounds-checked reads over a loaded capture.
+struct CaptureReader {
+    const unsigned char *p, *end;
+    bool ok = true;
+    template<class T> T get(){
+        T v{};
+        if((size_t)(end - p) < sizeof(T)){ ok = false; return v; }
+        memcpy(&v, p, sizeof(T)); p += sizeof(T);
+        return v;
+    }
+    const unsigned char *take(size_t bytes){
+        if((size_t)(end - p) < bytes){ ok = false; return nullptr; }
+        const unsigned char *at = p; p += bytes;
+        return at;
+    }
+};
 
-    // --- Walls with texture ---
-    glBindTexture(GL_TEXTURE_2D, wallTexture);
-    for(auto &w: walls)
-        addRectTextured(triBuf, w.x*sx, w.y*sy, w.w*sx, w.h*sy, glm::vec4(1.0f));
+static int runReplay(const BenchOptions &opt){
+    typedef std::chrono::steady_clock Clock;
+    auto ms = [](Clock::time_point a, Clock::time_point b){ return std::chrono::duration<double, std::milli>(b - a).count(); };
 
-    // --- Colored objects ---
-    glUniform1i(glGetUniformLocation(shader,"useTexture"), false);
+    MappedFile file;
+    if(!file.open(opt.replay)){ std::cerr<<"Replay: cannot open "<<opt.replay<<"\n"; return 1; }
+    CaptureHeader hdr;
+    if(file.size < sizeof(hdr)){ std::cerr<<"Replay: "<<opt.replay<<" is truncated\n"; return 1; }
+    memcpy(&hdr, file.data, sizeof(hdr));
+    if(hdr.magic!=CAPTURE_MAGIC || hdr.version!=CAPTURE_VERSION || hdr.fileSize!=file.size){
+        std::cerr<<"Replay: "<<opt.replay<<" is not a version "<<CAPTURE_VERSION<<" capture\n"; return 1;
+    }
+    if(hdr.idxSize != sizeof(ImDrawIdx)){ std::cerr<<"Replay: capture uses "<<hdr.idxSize<<"-byte ImGui indices\n"; return 1; }
+    auto section = [&](uint64_t at, uint64_t bytes){
+        CaptureReader r{file.data, file.data};
+        if(at <= file.size && bytes <= file.size - at){ r.p = file.data + at; r.end = r.p + bytes; }
+        else r.ok = false;
+        return r;
+    };
+    const CaptureView &v = hdr.view;
+    const int width = v.canvasW, height = v.canvasH;
+    if(width <= 0 || height <= 0){ std::cerr<<"Replay: bad canvas size\n"; return 1; }
 
-    for(auto &k: kitchen) addRectTriangles(triBuf, k.x*sx, k.y*sy, k.w*sx, k.h*sy, k.color);
-    for(auto &b: bar) addRectTriangles(triBuf, b.x*sx, b.y*sy, b.w*sx, b.h*sy, b.color);
-    for(auto &win: windows) addRectTriangles(triBuf, win.x*sx, win.y*sy, win.w*sx, win.h*sy, win.color);
-    for(auto &r: restrooms) addRectTriangles(triBuf, r.x*sx, r.y*sy, r.w*sx, r.h*sy, r.color);
-    for(auto &f: fire) addRectTriangles(triBuf, f.x*sx, f.y*sy, f.w*sx, f.h*sy, f.color);
+    // Plan state
+    FloorPlan plan;
+    CaptureReader lr = section(hdr.layoutAt, hdr.layoutBytes);
+    const unsigned char *layout = lr.take(hdr.layoutBytes);
+    if(!lr.ok || !plan.loadBinaryLayout(std::vector<unsigned char>(layout, layout + hdr.layoutBytes), opt.replay)) return 1;
+    plan.camera.cx = v.cx; plan.camera.cy = v.cy; plan.camera.zoom = v.zoom;
+    plan.scaleX = v.scaleX; plan.scaleY = v.scaleY;
+    plan.showGrid = v.showGrid; plan.showLabels = v.showLabels; plan.showDoorSwings = v.showDoorSwings;
+    plan.showDimensions = v.showDimensions; plan.showDrains = v.showDrains; plan.showScaleBar = v.showScaleBar;
+    plan.showWindows = v.showWindows; plan.showDoors = v.showDoors;
+    plan.useInstancing = v.useInstancing; plan.useAnalyticShapes = v.useAnalyticShapes;
+    plan.overlay.declutter = v.declutter; plan.editMode = v.editMode;
+    if(v.selectedCat < CAT_COUNT && v.selectedIndex < plan.categorySize(v.selectedCat)) plan.selected = {v.selectedCat, v.selectedIndex};
+    plan.initGL(width, height);
+    plan.updateProjection(width, height);
+    plan.loadTextures();
+    while(gSceneTextures.busy()){ gSceneTextures.pumpUploads(); std::this_thread::sleep_for(std::chrono::milliseconds(1)); }
+    while(gSceneTextures.pumpUploads()) {}
 
-    glm::vec4 doorColor(0.545f,0.271f,0.075f,1.0f);
-    for(auto &d: doors) addRectTriangles(triBuf, d.x*sx, d.y*sy, d.w*sx, d.h*sy, doorColor);
+    OffscreenTarget target;
+    if(!target.init(width, height)){
+        std::cerr<<"Replay: offscreen framebuffer incomplete\n";
+        plan.destroy();
+        return 1;
+    }
+    // One frame with both elevation windows open renders their cached textures.
+    auto appFrame = [&](bool elevations){
+        ImGui_ImplOpenGL3_NewFrame();
+        ImGui_ImplGlfw_NewFrame();
+        ImGui::NewFrame();
+        if(elevations){
+            ProfileScope p(gProfiler, "elevations");
+            plan.drawFrontElevationView(gShaders);
+            plan.drawSideElevationView(gShaders);
+        }
+        glClearColor(v.clear[0], v.clear[1], v.clear[2], v.clear[3]);
+        glClear(GL_COLOR_BUFFER_BIT);
+        { ProfileScope p(gProfiler, "render", true); plan.render(gShaders); }
+        { ProfileScope p(gProfiler, "drawOverlays"); plan.drawOverlays(); }
+        ImGui::Render();
+        { ProfileScope p(gProfiler, "ImGui_ImplOpenGL3_RenderDrawData", true); ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData()); }
+    };
+    plan.showFrontElevation = plan.showSideElevation = true;
+    appFrame(true);
+    plan.showFrontElevation = v.showFrontElevation; plan.showSideElevation = v.showSideElevation;
+    GLuint textures[TR_ROLE_COUNT] = {0, gSceneTextures.tex, plan.frontElevation.tex, plan.sideElevation.tex, FrameCapture::fontTexture()};
 
-    for(auto &t: tablesRect) addRectTriangles(triBuf, t.x*sx, t.y*sy, t.w*sx, t.h*sy, t.color);
-    for(auto &c: tablesCircle) addCircleTriangles(triBuf, c.x*sx, c.y*sy, c.r*sx, 20, c.color);
-   
-    triBuf.uploadAndDrawTriangles(GL_TRIANGLES);
+    // Captured buffers, rebuilt as the app's own buffer types.
+    CaptureReader nr = section(hdr.namesAt, hdr.namesBytes);
+    std::vector<std::string> names;
+    for(uint32_t i=0;i<hdr.nameCount && nr.ok;i++){
+        const unsigned char *z = (const unsigned char*)memchr(nr.p, 0, nr.end - nr.p);
+        if(!z){ nr.ok = false; break; }
+        names.emplace_back((const char*)nr.p, z - nr.p);
+        nr.p = z + 1;
+    }
+    CaptureReader br = section(hdr.blobsAt, (uint64_t)hdr.blobCount*sizeof(FrameRecorder::Blob));
+    CaptureReader dr = section(hdr.dataAt, hdr.dataBytes);
+    // Counts size the tables below; a count the file cannot hold is corruption, not an allocation.
+    if(!br.ok || hdr.opCount > hdr.opsBytes || hdr.nameCount > hdr.namesBytes || hdr.listCount > hdr.imguiBytes){
+        std::cerr<<"Replay: "<<opt.replay<<" is corrupt\n";
+        target.destroy();
+        plan.destroy();
+        return 1;
+    }
+    UnitMeshes meshes;
+    meshes.init();
+    const GLint meshVertices = meshes.circleFirst[CIRCLE_LOD_COUNT-1] + meshes.circleCount[CIRCLE_LOD_COUNT-1];
+    std::vector<DrawBuffer> vertexBlobs;
+    std::vector<InstanceBuffer> instanceBlobs;
+    std::vector<uint32_t> blobSlot(hdr.blobCount), blobItems(hdr.blobCount);
+    std::vector<uint8_t> blobKind(hdr.blobCount);
+    vertexBlobs.reserve(hdr.blobCount); instanceBlobs.reserve(hdr.blobCount);
+    for(uint32_t i=0;i<hdr.blobCount && br.ok && dr.ok;i++){
+        FrameRecorder::Blob b = br.get<FrameRecorder::Blob>();
+        CaptureReader bytes = section(hdr.dataAt + b.at, b.bytes);
+        if(b.at > hdr.dataBytes || b.bytes > hdr.dataBytes - b.at || !bytes.ok){ dr.ok = false; break; }
+        blobKind[i] = b.kind;
+        if(b.kind == FrameRecorder::BLOB_VERTICES){
+            vertexBlobs.emplace_back();
+            DrawBuffer &db = vertexBlobs.back();
+            db.init();
+            db.data.resize(b.bytes / sizeof(PackedVertex));
+            memcpy(db.data.data(), bytes.p, db.data.size()*sizeof(PackedVertex));
+            db.vertexCount = db.data.size();
+            db.upload();
+            blobSlot[i] = (uint32_t)vertexBlobs.size()-1; blobItems[i] = (uint32_t)db.vertexCount;
+        } else {
+            instanceBlobs.emplace_back();
+            InstanceBuffer &ib = instanceBlobs.back();
+            ib.init(meshes, 0, 0, false);
+            ib.data.resize(b.bytes / sizeof(ShapeInstance));
+            memcpy(ib.data.data(), bytes.p, ib.data.size()*sizeof(ShapeInstance));
+            ib.upload();
+            blobSlot[i] = (uint32_t)instanceBlobs.size()-1; blobItems[i] = (uint32_t)ib.data.size();
+        }
+    }
 
-    // ------------------ LINES ------------------
-    lineBuf.begin();
-   
-    // Grid
-    if(showGrid){
-        glm::vec4 gcol(0.0f,0.0f,0.0f,0.06f);
-        int step = 50;
-        for(int x=50;x<=1150;x+=step) lineBuf.pushVertex(x*sx,50*sy,gcol.r,gcol.g,gcol.b,gcol.a), lineBuf.pushVertex(x*sx,750*sy,gcol.r,gcol.g,gcol.b,gcol.a);
-        for(int y=50;y<=750;y+=step) lineBuf.pushVertex(50*sx,y*sy,gcol.r,gcol.g,gcol.b,gcol.a), lineBuf.pushVertex(1150*sx,y*sy,gcol.r,gcol.g,gcol.b,gcol.a);
+    // Decode the stream once, resolving programs and uniforms by name, so the timed
+    // loop is straight GL calls.
+    std::vector<ReplayCmd> cmds;
+    CaptureReader r = section(hdr.opsAt, hdr.opsBytes);
+    ShaderProgram *prog = nullptr;
+    bool valid = nr.ok && br.ok && dr.ok && r.ok;
+    auto nameAt = [&](uint16_t id) -> const std::string* { if(id >= names.size()){ valid = false; return nullptr; } return &names[id]; };
+    for(uint32_t n=0; n<hdr.opCount && valid && r.ok; n++){
+        ReplayCmd c{};
+        c.op = r.get<uint8_t>();
+        switch(c.op){
+        case FrameRecorder::OP_PROGRAM: {
+            const std::string *pn = nameAt(r.get<uint16_t>());
+            prog = pn ? gShaders.byName(*pn) : nullptr;
+            if(!prog){ std::cerr<<"Replay: unknown program\n"; valid = false; break; }
+            c.program = prog->id;
+            break;
+        }
+        case FrameRecorder::OP_MAT4: case FrameRecorder::OP_FLOAT: case FrameRecorder::OP_INT: {
+            const std::string *un = nameAt(r.get<uint16_t>());
+            size_t bytes = c.op==FrameRecorder::OP_MAT4 ? sizeof(c.f) : 4;
+            const unsigned char *src = r.take(bytes);
+            if(!src || !un || !prog){ valid = false; break; }
+            memcpy(c.f, src, bytes);
+            int slot = prog->uniform(un->c_str());
+            c.loc = slot >= 0 ? prog->slots[slot].loc : -1;
+            break;
+        }
+        case FrameRecorder::OP_TEXTURE:
+            c.a = r.get<uint8_t>(); c.b = r.get<uint8_t>(); c.c = r.get<uint8_t>();
+            if(c.b >= (uint32_t)GLStateCache::UNITS || c.c >= TR_ROLE_COUNT) valid = false;
+            break;
+        case FrameRecorder::OP_DRAW_ARRAYS:
+            c.a = r.get<uint32_t>(); c.b = r.get<uint32_t>(); c.c = r.get<uint32_t>(); c.d = r.get<uint32_t>();
+            if(c.a >= hdr.blobCount || blobKind[c.a] != FrameRecorder::BLOB_VERTICES || (uint64_t)c.c + c.d > blobItems[c.a]) valid = false;
+            else c.a = blobSlot[c.a];
+            break;
+        case FrameRecorder::OP_DRAW_INSTANCED:
+            c.a = r.get<uint32_t>(); c.b = r.get<uint32_t>(); c.c = r.get<uint32_t>(); c.d = r.get<uint32_t>();
+            if(c.a >= hdr.blobCount || blobKind[c.a] != FrameRecorder::BLOB_INSTANCES || c.d > blobItems[c.a] ||
+               (int32_t)c.b < 0 || (int32_t)c.c < 0 || (int64_t)(int32_t)c.b + (int32_t)c.c > meshVertices) valid = false;
+            else c.a = blobSlot[c.a];
+            break;
+        default: valid = false;
+        }
+        cmds.push_back(c);
     }
 
-    glm::vec4 outlineColor(0.2f,0.24f,0.28f,1.0f);
-    for(auto &w: walls) addRectLines(lineBuf, w.x*sx, w.y*sy, w.w*sx, w.h*sy, outlineColor);
-    for(auto &k: kitchen) addRectLines(lineBuf, k.x*sx, k.y*sy, k.w*sx, k.h*sy, glm::vec4(0.12f,0.12f,0.12f,1.0f));
-    for(auto &t: tablesRect) addRectLines(lineBuf, t.x*sx, t.y*sy, t.w*sx, t.h*sy, glm::vec4(0.62f,0.36f,0.12f,1.0f));
+    // ImGui lists
+    CaptureReader ur = section(hdr.imguiAt, hdr.imguiBytes);
+    CaptureDisplay disp = ur.get<CaptureDisplay>();
+    std::vector<std::unique_ptr<ImDrawList>> lists;
+    size_t uiVertices = 0;
+    for(uint32_t n=0; n<hdr.listCount && ur.ok && valid; n++){
+        uint32_t vtx = ur.get<uint32_t>(), idx = ur.get<uint32_t>(), ncmd = ur.get<uint32_t>();
+        const unsigned char *vsrc = ur.take((size_t)vtx*sizeof(ImDrawVert));
+        const unsigned char *isrc = ur.take((size_t)idx*sizeof(ImDrawIdx));
+        const unsigned char *csrc = ur.take((size_t)ncmd*sizeof(CaptureCmd));
+        if(!ur.ok) break;
+        lists.emplace_back(new ImDrawList(ImGui::GetDrawListSharedData()));
+        ImDrawList &dl = *lists.back();
+        dl.VtxBuffer.resize((int)vtx); memcpy(dl.VtxBuffer.Data, vsrc, (size_t)vtx*sizeof(ImDrawVert));
+        dl.IdxBuffer.resize((int)idx); memcpy(dl.IdxBuffer.Data, isrc, (size_t)idx*sizeof(ImDrawIdx));
+        for(uint32_t k=0;k<ncmd;k++){
+            CaptureCmd cc;
+            memcpy(&cc, csrc + k*sizeof(CaptureCmd), sizeof(cc));
+            if((uint64_t)cc.idxOffset + cc.elemCount > idx || cc.vtxOffset > vtx || cc.role >= TR_ROLE_COUNT){ valid = false; break; }
+            // Indices are relative to vtxOffset; any that reach past the list would read off the VBO.
+            for(uint32_t e=0;e<cc.elemCount && valid;e++)
+                if((uint64_t)cc.vtxOffset + dl.IdxBuffer.Data[cc.idxOffset + e] >= vtx) valid = false;
+            if(!valid) break;
+            ImDrawCmd dc = ImDrawCmd();
+            dc.ClipRect = ImVec4(cc.clip[0], cc.clip[1], cc.clip[2], cc.clip[3]);
+            dc.VtxOffset = cc.vtxOffset; dc.IdxOffset = cc.idxOffset; dc.ElemCount = cc.elemCount;
+#if IMGUI_VERSION_NUM >= 19200
+            dc.TexRef = ImTextureRef((ImTextureID)textures[cc.role]);
+#else
+            dc.TextureId = (ImTextureID)(intptr_t)textures[cc.role];
+#endif
+            dl.CmdBuffer.push_back(dc);
+        }
+        uiVertices += vtx;
+    }
+    valid = valid && ur.ok;
+    ImDrawData dd;
+    dd.Valid = true;
+    dd.DisplayPos = ImVec2(disp.pos[0], disp.pos[1]);
+    dd.DisplaySize = ImVec2(disp.size[0], disp.size[1]);
+    dd.FramebufferScale = ImVec2(disp.scale[0], disp.scale[1]);
+#if IMGUI_VERSION_NUM >= 18980
+    for(auto &dl: lists) dd.AddDrawList(dl.get());
+#else
+    std::vector<ImDrawList*> listPtrs;
+    for(auto &dl: lists){ listPtrs.push_back(dl.get()); dd.TotalVtxCount += dl->VtxBuffer.Size; dd.TotalIdxCount += dl->IdxBuffer.Size; }
+    dd.CmdLists = listPtrs.data(); dd.CmdListsCount = (int)listPtrs.size();
+#endif
+#if IMGUI_VERSION_NUM >= 19200
+    dd.Textures = &ImGui::GetPlatformIO().Textures;
+#endif
 
-    lineBuf.uploadAndDrawTriangles(GL_LINES);
-}
+    auto cleanup = [&]{
+        for(auto &b: vertexBlobs) b.destroy();
+        for(auto &b: instanceBlobs) b.destroy();
+        meshes.destroy();
+        target.destroy();
+        plan.destroy();
+    };
+    if(!valid){ std::cerr<<"Replay: "<<opt.replay<<" is corrupt\n"; cleanup(); return 1; }
 
+    auto streamFrame = [&]{
+        glClearColor(v.clear[0], v.clear[1], v.clear[2], v.clear[3]);
+        glClear(GL_COLOR_BUFFER_BIT);
+        {
+            ProfileScope p(gProfiler, "replay.stream", true);
+            for(const ReplayCmd &c: cmds){
+                switch(c.op){
+                case FrameRecorder::OP_PROGRAM: glUseProgram(c.program); break;
+                case FrameRecorder::OP_MAT4: glUniformMatrix4fv(c.loc, 1, GL_FALSE, c.f); break;
+                case FrameRecorder::OP_FLOAT: glUniform1f(c.loc, c.f[0]); break;
+                case FrameRecorder::OP_INT: { GLint i; memcpy(&i, c.f, sizeof(i)); glUniform1i(c.loc, i); break; }
+                case FrameRecorder::OP_TEXTURE:
+                    glActiveTexture(GL_TEXTURE0 + c.b);
+                    glBindTexture(c.a ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, textures[c.c]);
+                    break;
+                case FrameRecorder::OP_DRAW_ARRAYS:
+                    glBindVertexArray(vertexBlobs[c.a].vao);
+                    glDrawArrays(c.b, (GLint)c.c, (GLsizei)c.d);
+                    gProfiler.frame.drawCalls++; gProfiler.frame.vertices += c.d;
+                    break;
+                case FrameRecorder::OP_DRAW_INSTANCED:
+                    glBindVertexArray(instanceBlobs[c.a].vao);
+                    glDrawArraysInstanced(GL_TRIANGLES, (GLint)c.b, (GLsizei)c.c, (GLsizei)c.d);
+                    gProfiler.frame.drawCalls++; gProfiler.frame.instances += c.d; gProfiler.frame.vertices += (uint64_t)c.c*c.d;
+                    break;
+                }
+            }
+            glBindVertexArray(0);
+            glActiveTexture(GL_TEXTURE0);
+        }
+        { ProfileScope p(gProfiler, "replay.imgui", true); ImGui_ImplOpenGL3_RenderDrawData(&dd); }
+        // The stream bound behind the wrappers' backs.
+        gGLState.invalidate();
+        gShaders.forgetUniforms();
+    };
 
-    void destroy(){ triBuf.destroy(); lineBuf.destroy(); }
-};
+    // Each phase: warmup, then timed frames ended by glFinish; passes averaged per phase.
+    struct Phase { std::vector<double> frameMs; Profiler::Counters total; std::vector<std::pair<const char*, std::pair<double,double>>> passes; };
+    gProfiler.enabled = true;
+    auto runPhase = [&](const std::function<void()> &frame){
+        Phase ph;
+        std::vector<double> cpu(Profiler::MAX_PASSES, 0.0), gpu(Profiler::MAX_PASSES, 0.0);
+        for(int f=-opt.warmup; f<opt.frames; f++){
+            gProfiler.beginFrame();
+            auto start = Clock::now();
+            frame();
+            glFinish();
+            double frameTime = ms(start, Clock::now());
+            gProfiler.endFrame();
+            if(f < 0) continue;
+            ph.frameMs.push_back(frameTime);
+            const Profiler::Counters &c = gProfiler.last;
+            ph.total.drawCalls += c.drawCalls; ph.total.vertices += c.vertices; ph.total.instances += c.instances;
+            ph.total.bytesUploaded += c.bytesUploaded; ph.total.allocations += c.allocations;
+            for(int i=0;i<gProfiler.passCount;i++){ cpu[i] += gProfiler.passes[i].cpuMs; gpu[i] += gProfiler.passes[i].gpuMs; }
+        }
+        double n = std::max<size_t>(ph.frameMs.size(), 1);
+        for(int i=0;i<gProfiler.passCount;i++)
+            if(cpu[i] > 0.0 || gpu[i] > 0.0) ph.passes.push_back({gProfiler.passes[i].name, {cpu[i]/n, gpu[i]/n}});
+        return ph;
+    };
+    Phase stream = runPhase(streamFrame);
+    Phase app = runPhase([&]{ appFrame(v.showFrontElevation || v.showSideElevation); });
 
+    FILE* out = opt.out.empty() ? stdout : fopen(opt.out.c_str(), "wb");
+    if(!out){ std::cerr<<"Replay: cannot write "<<opt.out<<"\n"; out = stdout; }
+    std::string captureName, fieldRenderer, renderer;
+    jsonEscape(captureName, opt.replay);
+    jsonEscape(fieldRenderer, std::string(hdr.renderer, strnlen(hdr.renderer, sizeof(hdr.renderer))));
+    const char *gl = (const char*)glGetString(GL_RENDERER);
+    jsonEscape(renderer, gl ? gl : "");
+    fprintf(out, "{\n  \"capture\": %s,\n  \"captured_on\": %s,\n  \"replayed_on\": %s,\n", captureName.c_str(), fieldRenderer.c_str(), renderer.c_str());
+    fprintf(out, "  \"width\": %d,\n  \"height\": %d,\n  \"frames\": %d,\n  \"field_frame_ms\": %.3f,\n", width, height, opt.frames, v.fieldFrameMs);
+    fprintf(out, "  \"stream\": {\"ops\": %u, \"draws\": %u, \"data_bytes\": %llu, \"imgui_lists\": %u, \"imgui_vertices\": %zu},\n",
+            hdr.opCount, hdr.drawCount, (unsigned long long)hdr.dataBytes, hdr.listCount, uiVertices);
+    auto writePhase = [&](const char *key, const Phase &ph, bool last){
+        double n = std::max<size_t>(ph.frameMs.size(), 1);
+        fprintf(out, "  \"%s\": {\n    \"frame_ms\": ", key);
+        writeFrameStats(out, ph.frameMs);
+        fprintf(out, ",\n    \"per_frame\": {\"draw_calls\": %.1f, \"vertices\": %.1f, \"instances\": %.1f, \"bytes_uploaded\": %.1f, \"allocations\": %.1f},\n",
+                ph.total.drawCalls/n, ph.total.vertices/n, ph.total.instances/n, ph.total.bytesUploaded/n, ph.total.allocations/n);
+        fprintf(out, "    \"passes\": {");
+        for(size_t i=0;i<ph.passes.size();i++)
+            fprintf(out, "%s\n      \"%s\": {\"cpu_ms\": %.4f, \"gpu_ms\": %.4f}", i ? "," : "", ph.passes[i].first, ph.passes[i].second.first, ph.passes[i].second.second);
+        fprintf(out, "\n    }\n  }%s\n", last ? "" : ",");
+    };
+    writePhase("replay_stream", stream, false);
+    writePhase("replay_app", app, true);
+    fprintf(out, "}\n");
+    if(out != stdout) fclose(out);
+    cleanup();
+    return 0;
+}
 
-// ---------------------- GLFW + Main ----------------------
-static FloorPlan *gPlan = nullptr;
-static GLuint gProgram = 0;
-static int gWinW=1280,gWinH=800;
-static void framebuffer_size_cb(GLFWwindow*, int w,int h){
-    if(w>0 && h>0){ gWinW=w; gWinH=h; if(gPlan) gPlan->updateProjection(w,h); }
+static void shutdown(GLFWwindow* window){
+    gExport.shutdown();
+    gWorkers.stop(); // no decode job may outlive gSceneTextures
+    gJobs.stop();
+    gScenes.destroy();
+    gSceneTextures.destroy();
+    gProfiler.destroy();
+    ImGui_ImplOpenGL3_Shutdown();
+    ImGui_ImplGlfw_Shutdown();
+    ImGui::DestroyContext();
+    gShaders.destroy();
+    glfwDestroyWindow(window);
+    glfwTerminate();
 }
-int main() {
+
+int main(int argc, char** argv) {
+    BenchOptions bench;
+    std::vector<std::string> layoutPaths;
+    for(int i=1;i<argc;i++) if(!parseBenchArg(bench, argc, argv, i)) layoutPaths.push_back(argv[i]);
+    const bool offscreen = bench.enabled || !bench.replay.empty();
+    if(bench.enabled){
+        if(!layoutPaths.empty()) bench.layout = layoutPaths[0];
+        gWinW = bench.width; gWinH = bench.height;
+    }
+
     if(!glfwInit()){ fprintf(stderr,"glfwInit failed\n"); return 1; }
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR,3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR,3);
     glfwWindowHint(GLFW_OPENGL_PROFILE,GLFW_OPENGL_CORE_PROFILE);
+    if(offscreen) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
     GLFWwindow* window = glfwCreateWindow(gWinW,gWinH,"Restaurant Floor Plan (2D Modern OpenGL)",nullptr,nullptr);
     if(!window){ fprintf(stderr,"Window creation failed\n"); glfwTerminate(); return 1; }
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_cb);
+    glfwSetWindowRefreshCallback(window, [](GLFWwindow*){ gRedraw.request(); });
+    glfwSwapInterval(offscreen ? 0 : 1); // vsync: never outrun the display, even in continuous mode
 
     if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)){ fprintf(stderr,"gladLoadGLLoader failed\n"); return 1; }
 
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    gProgram = createProgram(VERT_SRC, FRAG_SRC);
+    gShaders.init();
 
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -789,61 +5894,152 @@ int main() {
     ImGui_ImplGlfw_InitForOpenGL(window,true);
     ImGui_ImplOpenGL3_Init("#version 330 core");
 
-    FloorPlan plan;
-    plan.init(1200,800);
-    gPlan = &plan;
+    unsigned hw = std::thread::hardware_concurrency();
+    gWorkers.start(hw > 2 ? (int)hw-1 : 2);
+    gJobs.start(hw > 1 ? (int)hw-1 : 0); // the GL thread is the remaining one
+    if(offscreen){
+        int rc = bench.replay.empty() ? runBenchmark(bench) : runReplay(bench);
+        shutdown(window);
+        return rc;
+    }
+
+    // Each command-line layout is one floor; without any, the built-in layout.
+    glfwGetFramebufferSize(window, &gWinW, &gWinH);
+    gScenes.canvasW = gWinW; gScenes.canvasH = gWinH;
+    for(auto &path: layoutPaths) gScenes.add(path, path);
+    if(gScenes.floors.empty()) gScenes.add("Ground Floor", "");
+    gScenes.loadNow(0);
+    gScenes.request(0);
+    gScenes.update();
+    gScenes.active().loadTextures(); // once: every floor samples gSceneTextures
 
     // --- Main loop ---
     while(!glfwWindowShouldClose(window)){
-        glfwPollEvents();
+        gRedraw.waitEvents(io.WantTextInput ? 0.5 : 0.0);
+        gProfiler.beginFrame();
+        gScenes.update();
+        FloorPlan &plan = gScenes.active();
 
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
+        // Input is read after NewFrame(): the backend queues events and ImGui only applies
+        // them there, so reading io before it sees last frame's clicks and no wheel at all.
+        // Camera: wheel zooms about the cursor, right/middle drag pans, F fits the plan.
+        const bool mouseValid = ImGui::IsMousePosValid();
+        if(!io.WantCaptureMouse && mouseValid){
+            if(io.MouseWheel != 0.0f) plan.zoomAt(io.MousePos.x, io.MousePos.y, powf(1.15f, io.MouseWheel));
+            if((ImGui::IsMouseDragging(ImGuiMouseButton_Right, 0.0f) || ImGui::IsMouseDragging(ImGuiMouseButton_Middle, 0.0f))
+               && (io.MouseDelta.x != 0.0f || io.MouseDelta.y != 0.0f))
+                plan.panBy(io.MouseDelta.x, io.MouseDelta.y);
+        }
+        if(!io.WantCaptureKeyboard && ImGui::IsKeyPressed(ImGuiKey_F)) plan.zoomToFit();
+
+        // Editing: left button selects, drags and resizes (handle at the bottom-right).
+        if(plan.editMode){
+            if(mouseValid){
+                glm::vec2 w = plan.screenToWorld(io.MousePos.x, io.MousePos.y);
+                if(!io.WantCaptureMouse && ImGui::IsMouseClicked(ImGuiMouseButton_Left)) plan.editPointerDown(w.x, w.y);
+                if(ImGui::IsMouseDragging(ImGuiMouseButton_Left, 0.0f)) plan.editPointerDrag(w.x, w.y);
+            }
+            if(ImGui::IsMouseReleased(ImGuiMouseButton_Left)) plan.editPointerUp();
+            if(!io.WantCaptureKeyboard){
+                if(ImGui::IsKeyPressed(ImGuiKey_Delete)) plan.deleteSelected();
+                if(io.KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_Z)){ if(io.KeyShift) plan.redo(); else plan.undo(); }
+                if(io.KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_Y)) plan.redo();
+            }
+        }
+
         ImGui::Begin("Controls");
         // Inside your main loop, after "Controls" window:
 	
     	if (plan.showFrontElevation) {
-    	plan.drawFrontElevationView();
+    	ProfileScope p(gProfiler, "front elevation");
+    	plan.drawFrontElevationView(gShaders);
 	}
 	if (plan.showSideElevation) {
-	    plan.drawSideElevationView();
+	    ProfileScope p(gProfiler, "side elevation");
+	    plan.drawSideElevationView(gShaders);
 	}
+        if(ImGui::BeginCombo("Floor", gScenes.floors[gScenes.requested].name.c_str())){
+            for(int i=0;i<(int)gScenes.floors.size();i++)
+                if(ImGui::Selectable(gScenes.floors[i].name.c_str(), i==gScenes.requested)) gScenes.request(i);
+            ImGui::EndCombo();
+        }
+        if(gScenes.requested != gScenes.activeIndex){ ImGui::SameLine(); ImGui::Text("loading..."); }
+        ImGui::Text("Resident floors: %.1f MB", gScenes.residentBytes()/(1024.0*1024.0));
 	if(ImGui::Button("Reset Layout")) plan.setupDefaultLayout();
+        static char layoutPath[256] = "layout.fplan";
+        ImGui::InputText("Layout File", layoutPath, sizeof(layoutPath));
+        if(ImGui::Button("Load")) plan.loadLayout(layoutPath);
+        ImGui::SameLine(); if(ImGui::Button("Save")) plan.saveLayout(layoutPath);
         ImGui::Checkbox("Show Grid",&plan.showGrid);
         ImGui::Checkbox("Show Labels",&plan.showLabels);
+        ImGui::Checkbox("Declutter Labels",&plan.overlay.declutter);
         ImGui::Checkbox("Show Door Swings",&plan.showDoorSwings);
         ImGui::Checkbox("Show Dimensions",&plan.showDimensions);
+        ImGui::Checkbox("Instanced Shapes",&plan.useInstancing);
+        if(plan.useInstancing){ ImGui::SameLine(); ImGui::Checkbox("Analytic Shapes",&plan.useAnalyticShapes); }
+        ImGui::Checkbox("Continuous Redraw",&gRedraw.continuous);
+        ImGui::Checkbox("Show Profiler",&gProfiler.showPanel);
        	ImGui::Checkbox("Show Front Elevation", &plan.showFrontElevation);
+        gExport.drawControls(plan);
+        gCapture.drawControls();
+        plan.drawEgressControls();
+        gScenes.drawSeating();
+        ImGui::Checkbox("Edit Mode", &plan.editMode);
+        if(plan.editMode){
+            float cx = plan.camera.cx, cy = plan.camera.cy;
+            ItemRow row;
+            if(ImGui::Button("Add Table")){ row.rect = {cx-25, cy-25, 50, 50, glm::vec4(0.545f,0.271f,0.075f,1.0f), "Table"}; plan.addItem(CAT_TABLE_RECT, row); }
+            ImGui::SameLine();
+            if(ImGui::Button("Add Chair")){ row.rect = {cx-6, cy-10, 12, 20, glm::vec4(0.10f,0.54f,0.22f,1.0f), "Chair"}; plan.addItem(CAT_TABLE_RECT, row); }
+            ImGui::SameLine();
+            if(ImGui::Button("Add Round Table")){ row.circle = {cx, cy, 25, glm::vec4(0.902f,0.494f,0.133f,1.0f), "Round Table"}; plan.addItem(CAT_TABLE_CIRCLE, row); }
+            if(ImGui::Button("Delete")) plan.deleteSelected();
+            ImGui::SameLine(); if(ImGui::Button("Undo")) plan.undo();
+            ImGui::SameLine(); if(ImGui::Button("Redo")) plan.redo();
+            ImGui::SameLine(); ImGui::Text("%d / %d", (int)plan.undoStack.size(), (int)plan.redoStack.size());
+        }
+        if(ImGui::Button("Zoom to Fit")) plan.zoomToFit();
+        ImGui::SameLine(); ImGui::Text("Zoom %.0f%%", plan.camera.zoom*100.0f);
+        if(!io.WantCaptureMouse && mouseValid){
+            glm::vec2 w = plan.screenToWorld(io.MousePos.x, io.MousePos.y);
+            ItemRef hit = plan.hitTest(w.x, w.y);
+            if(hit.valid()){
+                const std::string &label = plan.itemLabel(hit);
+                ImGui::Text("Under cursor: %s", label.empty() ? "(unlabelled)" : label.c_str());
+                ImGui::Text("Within 10 units: %d items", (int)plan.findOverlaps(hit, 10.0f).size());
+                if((hit.cat==CAT_TABLE_RECT || hit.cat==CAT_TABLE_CIRCLE) && plan.seating.at(hit).role==SeatIndex::ROLE_TABLE)
+                    ImGui::Text("Seats: %d", (int)plan.seating.at(hit).children.size());
+            }
+        }
 		 //ImGui::Begin("Front Elevation Controls");
 	//ImGui::Checkbox("Show Windows", &plan.showWindows);
 	
 	ImGui::End();
-	glClearColor(0.925f,0.941f,0.945f,1.0f);
+        gProfiler.drawPanel([&]{ plan.drawBufferStats(); });
+        { ProfileScope p(gProfiler, "export", true); gExport.step(plan, gShaders); }
+        static const float clearColor[4] = {0.925f,0.941f,0.945f,1.0f};
+        gCapture.begin(plan, gShaders, clearColor);
+	glClearColor(clearColor[0],clearColor[1],clearColor[2],clearColor[3]);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        plan.render(gProgram);
-        //plan.drawLabels();  // <-- fixed capitalization and added semicolon
-        plan.drawDoorSwings();
-        plan.drawFloorDrains();
-        plan.drawDimensions();  // dynamic & scaled
-        plan.drawScaleBar();
-        plan.drawLabels();
+        gScenes.pollTextures();
+        { ProfileScope p(gProfiler, "render", true); plan.render(gShaders); }
+        { ProfileScope p(gProfiler, "drawOverlays"); plan.drawOverlays(); } // door swings, drains, dimensions, scale bar, labels
 //	plan.drawFrontElevation();
 //	plan.drawFrontElevationWindow(); 
         ImGui::Render();
 //        drawFrontElevation(plan);
-	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+	{ ProfileScope p(gProfiler, "ImGui_ImplOpenGL3_RenderDrawData", true); ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData()); }
+        gCapture.finish(plan, ImGui::GetDrawData());
+        gProfiler.endFrame();
         glfwSwapBuffers(window);
+        gRedraw.frameDone();
     }
 
-    plan.destroy();
-    ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
-    ImGui::DestroyContext();
-    glDeleteProgram(gProgram);
-    glfwDestroyWindow(window);
-    glfwTerminate();
+    shutdown(window);
     return 0;
 }